@@ -990,11 +990,6 @@ __interrupt void TIMER2_A0_ISR(void)
 	{
 	  while(1);
 	}
-	#pragma vector=DMA_VECTOR
-	__interrupt void Trap11_ISR(void)
-	{
-	  while(1);
-	}
 	#pragma vector=RTC_VECTOR
 	__interrupt void Trap12_ISR(void)
 	{
@@ -0,0 +1,242 @@
+/*****************************************************************************
+*
+*  config_store.c - Network and Exosite configuration store
+*  Copyright (C) 2014 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Texas Instruments Incorporated nor the names of
+*    its contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include <msp430.h>
+#include <stddef.h>
+#include <string.h>
+#include "flash.h"
+#include "config_store.h"
+
+// The configuration is kept twice, copy A and copy B, each in a segment of
+// its own. The copy in use is read in place; an update is built in RAM and
+// written to the other copy with a sequence number one higher, its CRC last.
+// Until the CRC is there the copy in use stays current, so an update cut
+// short by a power loss leaves the previous configuration in effect.
+
+// local defines
+#define CONFIG_COPY(n)  ((const network_config *)(CONFIG_START + (n) * FLASH_SEGMENT_SIZE))
+#define CONFIG_CRC_SIZE offsetof(network_config, crc)
+
+// Info flash fields of the configuration before the store, see configImport
+#define LEGACY_SSID     0x1800
+#define LEGACY_PASS     0x1820
+#define LEGACY_SECU     0x1840
+#define LEGACY_MAC      0x1850
+#define LEGACY_CIK      0x1880
+#define LEGACY_DEVNAME  0x1900
+#define LEGACY_MODNAME  0x1920
+
+// local functions
+unsigned int configCrc(const network_config * config);
+unsigned char configValid(const network_config * config);
+void configImport(char * field, unsigned int address, unsigned char size);
+
+// globals
+static const network_config * active = 0;   // copy in use, 0 if neither is valid
+static network_config draft;                // update being entered, in use while active is 0
+
+//*****************************************************************************
+//
+//!  configInit
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Finds the copy in use: the valid one, or of two valid copies the
+//!          one written last. Without one, the configuration left in info
+//!          flash by earlier firmware is taken over; if its copy doesn't
+//!          verify, it stays in use from RAM.
+//
+//*****************************************************************************
+void
+configInit(void)
+{
+  const network_config * a = CONFIG_COPY(0);
+  const network_config * b = CONFIG_COPY(1);
+
+  active = 0;
+  if (configValid(a))
+    active = a;
+  if (configValid(b) && (0 == active || (int)(b->sequence - a->sequence) > 0))
+    active = b;
+  if (0 != active)
+    return;
+
+  memset(&draft, 0, sizeof(draft));
+  configImport(draft.ssid, LEGACY_SSID, 32);
+  configImport(draft.pass, LEGACY_PASS, 32);
+  configImport(draft.secu, LEGACY_SECU, 1);
+  configImport(draft.mac, LEGACY_MAC, 12);
+  configImport(draft.cik, LEGACY_CIK, 40);
+  configImport(draft.devname, LEGACY_DEVNAME, 16);
+  configImport(draft.modname, LEGACY_MODNAME, 32);
+  configCommit();
+}
+
+//*****************************************************************************
+//
+//!  configActive
+//!
+//!  \param  None
+//!
+//!  \return the configuration in use, read in place in flash; the draft
+//!          while no copy in flash is valid, never 0
+//
+//*****************************************************************************
+const network_config *
+configActive(void)
+{
+  return (0 != active) ? active : &draft;
+}
+
+//*****************************************************************************
+//
+//!  configDraft
+//!
+//!  \param  None
+//!
+//!  \return the update to fill in, starting as a copy of the configuration
+//!          in use
+//
+//*****************************************************************************
+network_config *
+configDraft(void)
+{
+  // without a valid copy the draft is what is in use, so it stays
+  if (0 != active)
+    memcpy(&draft, active, sizeof(draft));
+  return &draft;
+}
+
+//*****************************************************************************
+//
+//!  configCommit
+//!
+//!  \param  None
+//!
+//!  \return 1 if the update is in use; 0 if it didn't verify
+//!
+//!  \brief  Writes the update over the copy not in use and switches to it
+//
+//*****************************************************************************
+int
+configCommit(void)
+{
+  const network_config * target = CONFIG_COPY(active == CONFIG_COPY(0) ? 1 : 0);
+
+  draft.version = CONFIG_VERSION;
+  draft.pad = 0xFF;
+  draft.sequence = (0 != active) ? active->sequence + 1 : 0;
+  draft.ssid[sizeof(draft.ssid) - 1] = 0;
+  draft.pass[sizeof(draft.pass) - 1] = 0;
+  draft.secu[sizeof(draft.secu) - 1] = 0;
+  draft.mac[sizeof(draft.mac) - 1] = 0;
+  draft.cik[sizeof(draft.cik) - 1] = 0;
+  draft.devname[sizeof(draft.devname) - 1] = 0;
+  draft.modname[sizeof(draft.modname) - 1] = 0;
+  draft.crc = configCrc(&draft);
+
+  flashEraseSegment((unsigned int)target);
+  flashWrite((unsigned int)target, &draft, CONFIG_CRC_SIZE);
+  // the commit
+  flashWrite((unsigned int)&target->crc, &draft.crc, sizeof(draft.crc));
+
+  if (!configValid(target))
+    return 0;
+  active = target;
+  return 1;
+}
+
+//*****************************************************************************
+//
+//!  configCrc
+//!
+//!  \param  config - configuration to check
+//!
+//!  \return CRC-16 of the configuration up to its crc field
+//!
+//!  \brief  Runs the bytes through the CRC16 module
+//
+//*****************************************************************************
+unsigned int
+configCrc(const network_config * config)
+{
+  const unsigned char * p = (const unsigned char *)config;
+  unsigned char i;
+
+  CRCINIRES = 0xFFFF;
+  for (i = 0; i < CONFIG_CRC_SIZE; i++)
+    CRCDIRB_L = p[i];
+  return CRCINIRES;
+}
+
+//*****************************************************************************
+//
+//!  configValid
+//!
+//!  \param  config - copy to check
+//!
+//!  \return 1 if the copy is complete and of this version; 0 if not
+//
+//*****************************************************************************
+unsigned char
+configValid(const network_config * config)
+{
+  return CONFIG_VERSION == config->version && configCrc(config) == config->crc;
+}
+
+//*****************************************************************************
+//
+//!  configImport
+//!
+//!  \param  field - draft field to fill; address - the field in info flash;
+//!          size - its size there
+//!
+//!  \return None
+//!
+//!  \brief  Copies a field of the earlier info flash configuration, which
+//!          runs up to the first erased byte
+//
+//*****************************************************************************
+void
+configImport(char * field, unsigned int address, unsigned char size)
+{
+  const char * p = (const char *)address;
+  unsigned char i;
+
+  for (i = 0; i < size && (char)0xFF != p[i]; i++)
+    field[i] = p[i];
+  field[i] = 0;
+}
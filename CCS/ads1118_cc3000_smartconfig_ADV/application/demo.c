@@ -78,11 +78,14 @@
 #include "sensors.h"
 #include "board.h"
 #include "string.h"
+#include <stdlib.h>
 #include "utils.h"
 #include "spi.h"
 #include "uart.h"
 #include "../exosite/exosite.h"
+#include "../exosite/exosite_retry.h"
 #include "common_adv.h"
+#include "sample_log.h"
 
 // ADS1118BP Custom variables and functions
 int sensorValue[10];
@@ -92,11 +95,40 @@ extern int radioStatus;
 extern volatile unsigned int  flag;
 unsigned int exoTimerPrev;
 unsigned long exoTimer;
+// Readings of the current sample window, at most one per sensor per second,
+// neither written nor logged yet. Timestamps are uptime until the window goes out.
+#define WINDOW_RECORDS (SAMPLE_WINDOW * SENSOR_END)
+exosite_record window[WINDOW_RECORDS];
+unsigned char windowCount = 0;
+unsigned char windowReadings = 0;	// seconds sampled in the window, published or not
+unsigned char windowSent = 0;		// records at the front being uploaded, kept in place
+unsigned char longPoll = 1;			// 0 once the server is seen not to hold a long-poll
+unsigned long setpointSince = 0;	// unix time of the last setpoint wait, 0 if none
+// Last reading of each sensor that went into the window, for its publish policy
+int publishedValue[SENSOR_END];
+unsigned long publishedAt[SENSOR_END];
+unsigned char published[SENSOR_END];
+
+// Control aliases read from Exosite, all in one request
+enum ctrlAliases
+{
+	DGR_CTRL,
+	THR_CTRL,
+	TIMER_CTRL,
+	CTRL_END
+};
+char ctrlValue[CTRL_END][12];
+exosite_value ctrlTable[CTRL_END] = {
+									{"dgr_ctrl", ctrlValue[DGR_CTRL], sizeof(ctrlValue[0]), 0},
+									{"thr_ctrl", ctrlValue[THR_CTRL], sizeof(ctrlValue[0]), 0},
+									{"timer_ctrl", ctrlValue[TIMER_CTRL], sizeof(ctrlValue[0]), 0}
+                                };
 
 extern void Timer2_A0_Init();
 extern void init_spi_ads1118(void);
 extern void lcd_system_Initial();
 extern void ads1118Main();
+extern void ads1118Tick(void);
 extern void LCD_display_string(unsigned char L, char *ptr);
 
 // Custom boot function
@@ -150,14 +182,12 @@ void main(void)
   	}
 
   #ifdef EN_COM_CONFIG
-  	  initNetworkInitRead(passMAC, PTRpassMAC, sizeof(passMAC));				// Read MAC from Flash due to dynamic network configuration
-  	  initNetworkInitRead(passDEVNAME, PTRpassDEVNAME, sizeof(passDEVNAME));	// Read DevServName from Flash due to dynamic network configuration
-  	  initNetworkInitRead(passMODNAME, PTRpassMODNAME, sizeof(passMODNAME));	// Read ModelName from Flash due to dynamic network configuration
-  	  memcpy(DevServname, passDEVNAME, sizeof(passDEVNAME));
+  	  configInit();		// Find the stored configuration, read in place from here on
+  	  strncpy(DevServname, configActive()->devname, sizeof(DevServname));
 
   	  // Initialize and confirm network credentials during first iteration
   	  // If no Device Name name is provided, do not time during dynamic configuration prompt
-  	  if (passDEVNAME[0] != 255)
+  	  if (configActive()->devname[0] != 0)
   	  {
   	  	  configFlag |= BIT6;
 		  initNetworkConfig();
@@ -169,7 +199,7 @@ void main(void)
   		initNetworkConfig();
   	  }
   	  // Must initialize one time for MAC address prepare..
-  	  if (!Exosite_Init("exosite", passMODNAME, IF_WIFI, 0))
+  	  if (!Exosite_Init("exosite", configActive()->modname, IF_WIFI, 0))
   #endif
   #ifndef EN_COM_CONFIG
 	  if (!Exosite_Init("exosite", "cc3000wifismartconfig", IF_WIFI, 0))	// HARDCODED - Model Name
@@ -179,6 +209,9 @@ void main(void)
 		while(1);
 	  }
 
+  // Find the readings that are still to be uploaded from earlier runs
+  logInit();
+
   // Main Loop
   while (1)
   {
@@ -201,8 +234,6 @@ void main(void)
     // If connectivity is good, run the primary functionality
     if(checkWiFiConnected())
     {
-      memset(exo_buffer, 0, sizeof(exo_buffer));
-      char * pbuf = exo_buffer;
       //unsolicicted_events_timer_disable(); //FACTORY ONLY
       configFlag &= ~BIT9;
       expireCount=0;
@@ -216,47 +247,21 @@ void main(void)
 
 // START EXOSITE READ
 // PROGRAMMER NOTE: To disable Exosite Read command, block comment from "// START EXOSITE READ" to "// END EXOSITE READ"
-        while (loopCount++ <= (WRITE_INTERVAL+1))
+// Reads done between writes - the write below reads the control aliases back in the same request
+        while (loopCount++ <= WRITE_INTERVAL)
         {
             sendString("== Exosite Read==\r\n");
-              if (Exosite_Read("dgr_ctrl", pbuf, EXO_BUFFER_SIZE))
-				{
-                  if (!strncmp(pbuf, "0", 1))
-                  {
-                	  flag ^= BIT8; //LCD Display in Fahrenheit
-                  }
-                  else if (!strncmp(pbuf, "1", 1))
-                  {
-                	  flag |= BIT8; //LCD Display in Celsius
-                  }
-				}
-              if (Exosite_Read("thr_ctrl", pbuf, EXO_BUFFER_SIZE))
-				{
-				exoTempThr = atoi(pbuf);
-				  if(exoTempThr != exoTempThrPrev)
-				  {
-					flag |= BIT1;
-					sendString("\tTemperature Threshold updated.\r\n");
-				  }
-				exoTempThrPrev = exoTempThr;
-				}
-			  if (Exosite_Read("timer_ctrl", pbuf, EXO_BUFFER_SIZE))
-				{
-				  exoTimer = atol(pbuf); //NOTE: limited to 65536 or 6hr55min36sec
-				  if (exoTimer != exoTimerPrev)
-				  {
-					flag |= BIT2;
-					sendString("\tCountdown Timer updated.\r\n");
-				  }
-				exoTimerPrev = exoTimer;
-				}
-			  else
+            if (Exosite_ReadMulti(ctrlTable, CTRL_END))			//read all control aliases in one request
+            {
+            	applyControls();
+            }
+			else
 				{
 					if (EXO_STATUS_NOAUTH == Exosite_StatusCode())
 					{
 						turnLedOff(LED2);
 						// Activate device again
-						cloud_status = Exosite_Activate();
+						cloud_status = Exosite_Activate() ? 0 : 1;
 						sendString("\tExosite Read fail!\r\n");
 					}
 				}
@@ -266,46 +271,92 @@ void main(void)
           busyWait(loop_time);	//delay before looping again
         }
 // END EXOSITE READ
+// START EXOSITE LONG-POLL
+// PROGRAMMER NOTE: The setpoint is waited on with the radio up while the window fills, so a
+// new threshold applies as soon as it is written. Without long-poll, the readings are taken
+// with the radio off and the controls come back with each write only.
+        while (longPoll && EXO_STATUS_NOAUTH != Exosite_StatusCode()
+               && windowReadings < SAMPLE_WINDOW)
+        {
+        	if (!waitSetpoint())
+        		break;
+        }
+// END EXOSITE LONG-POLL
 // START EXOSITE WRITE
 // PROGRAMMER NOTE: To disable Exosite Write command, block comment from "START EXOSITE WRITE" to "END EXOSITE WRITE"
         unsolicicted_events_timer_init();
     	if (EXO_STATUS_NOAUTH != Exosite_StatusCode())
     	{
-    	  sendString("== Exosite Write==\r\n\t");
-    	  unsigned char sensorCount = 0;
-          int value;
+    	  sendString("== Exosite Write/Read==\r\n\t");
+    	  unsigned char i;
+    	  int found = -1;
           char strRead[6]; //largest value of an int in ascii is 5 + null terminate
-          for (sensorCount = 0; sensorCount < SENSOR_END; sensorCount++)
+          itoa(windowCount, strRead, 10);
+          sendString(strRead);
+          sendString(" records\r\n");
+          unsolicicted_events_timer_init();
+          if (logClockValid())
           {
-        	  value = sensorValue[sensorCount];
-			  itoa(value, strRead, 10);                 //convert to a string
-			  unsolicicted_events_timer_init();
-			  //for each reading / data source (alias), we need to build the string "alias=value" (must be URL encoded)
-			  //this is all just an iteration of, for example, Exosite_Write("mydata=hello_world",18);
-			  memcpy(pbuf,&sensorNames[sensorCount][0],strlen(&sensorNames[sensorCount][0]));  //copy alias name into buffer
-			  pbuf += strlen(&sensorNames[sensorCount][0]);
-			  *pbuf++ = 0x3d;                           //put an '=' into buffer
-			  memcpy(pbuf,strRead, strlen(strRead));    //copy value into buffer
-			  pbuf += strlen(strRead);
-			  *pbuf++ = 0x26;                           //put an '&' into buffer, the '&' ties successive alias=val pairs together
+        	  for (i = 0; i < windowCount; i++)
+        		  window[i].timestamp = logUnixTime(window[i].timestamp);
+        	  //write the whole window to the cloud and read the control aliases back,
+        	  //sampling on while the upload is in flight
+        	  windowSent = windowCount;
+        	  if (Exosite_WriteRecordsReadAsync(window, windowSent, ctrlTable, CTRL_END, windowWritten, &found))
+        	  {
+        		  while (Exosite_Poll())
+        		  {
+        			  ads1118Tick();
+        		  }
+        	  }
+        	  else
+        	  {
+        		  windowWritten(-1, &found);
+        	  }
           }
-          pbuf--;										//back out the last '&'
-		  sendString(exo_buffer);
-		  sendString("\r\n");
-          Exosite_Write(exo_buffer,(pbuf - exo_buffer - 1));    //write all sensor values to the cloud
           configFlag &= ~BIT8;
           expireCount=0;
 
-          if (EXO_STATUS_OK == Exosite_StatusCode())
+          if (0 <= found)
           {
+        	  unsigned short reused, fresh;
         	  sendString("\tWrite SUCCESS!\r\n");
-        	  radioStatus = 0;
+        	  if (logPending() && windowCount < WINDOW_RECORDS)
+        	  {
+        		  // catch up on the readings logged while offline, staged in the free
+        		  // end of the window: its front holds what was sampled during the upload
+        		  sendString("\tUploaded from log: ");
+        		  itoa(logUpload(&window[windowCount], WINDOW_RECORDS - windowCount), strRead, 10);
+        		  sendString(strRead);
+        		  sendString(", left: ");
+        		  itoa(logPending(), strRead, 10);
+        		  sendString(strRead);
+        		  sendString("\r\n");
+        	  }
+        	  Exosite_ConnectionStats(&reused, &fresh);
+        	  sendString("\tConnections reused/fresh: ");
+        	  itoa(reused, strRead, 10);
+        	  sendString(strRead);
+        	  sendString("/");
+        	  itoa(fresh, strRead, 10);
+        	  sendString(strRead);
+        	  sendString("\r\n");
+        	  if (!longPoll)
+        		  radioStatus = 0;
           }
           else
 		  {
 			  sendString("\tWrite FAIL!\r\n");
+			  logSample();
+			  if (EXO_STATUS_NOAUTH == Exosite_StatusCode())
+			  {
+				  turnLedOff(LED2);
+				  // Activate device again
+				  cloud_status = Exosite_Activate() ? 0 : 1;
+			  }
 			  radioStatus = 0;
 			  show_status();
+			  loop_time = retryWait();
 		  }
     	}
       }
@@ -313,12 +364,18 @@ void main(void)
       else {
           //don't have a good connection yet - keep retrying to authenticate
           sendString("== Exosite Activate==\r\n");
-          sendString("\tBad connection. Retry authentication. Delay 30s...\r\n");
-          cloud_status = Exosite_Activate();
-          if (0 != cloud_status) loop_time = 30000; //delay 30 seconds before retrying...
+          sendString("\tBad connection. Retry authentication.\r\n");
+          cloud_status = Exosite_Activate() ? 0 : 1;
+          if (0 != cloud_status) loop_time = retryWait(); //delay by the backoff before retrying...
       }
         unsolicicted_events_timer_init();
       }
+    else
+    {
+      // keep the readings for later and retry on a restarted radio
+      logSample();
+      radioStatus = 0;
+    }
       // TODO - make this a sleep instead of busy wait
       busyWait(loop_time);	//delay before looping again
     }
@@ -333,7 +390,7 @@ void main(void)
 //!  \return TRUE if connected, FALSE if not
 //!
 //!  \brief  Checks to see that WiFi is still connected.  If not associated
-//!          with an AP for 5 consecutive retries, it will reset the board.
+//!          with an AP within ASSOC_TIMEOUT seconds, it gives up for now.
 //
 //*****************************************************************************
 unsigned char
@@ -348,7 +405,7 @@ checkWiFiConnected(void)
       // Smart Config not set, check whether we have an SSID from the assoc terminal command. If not, use fixed SSID.
     	sendString("== ConnectUsingSSID==\r\n");
     	#ifdef EN_COM_CONFIG
-    		ConnectUsingSSID((char *)passSSID, (unsigned char *)passPASS, (unsigned)atol(passSECU));
+    		ConnectUsingSSID((char *)configActive()->ssid, (unsigned char *)configActive()->pass, (unsigned)atol(configActive()->secu));
 		#endif
 		#ifndef EN_COM_CONFIG
     		ConnectUsingSSID(SSID, (unsigned char*)PASSPHRASE, SECURITY); //Enable to bypass manual network configuration
@@ -360,6 +417,7 @@ checkWiFiConnected(void)
 
     int sc_button_wait = 0;
     int sc_button_wait_clr = 0;
+    unsigned long assocStart = logUptime();
     sendString("\t(also checking Smart Config button)\r\n\t");
     configFlag &= ~BIT8;
     expireCount=0;
@@ -390,6 +448,9 @@ checkWiFiConnected(void)
       // Check if user pressed button to do Smart Config
       if(runSmartConfig == 1)
           break;
+      // Give up for now, so the readings get logged rather than lost
+      if(logUptime() - assocStart > ASSOC_TIMEOUT)
+          break;
     }
   }
   sendString("\r\n");
@@ -424,12 +485,21 @@ checkWiFiConnected(void)
     }
     if( ipInfoFlagSet == 1)
     {
-      // Initialize an Exosite connection
-      sendString("== Exosite Activate ==\r\n");
       configFlag &= ~BIT7;
       configFlag=0;
-      configFlag |= BIT9;
-      cloud_status = Exosite_Activate();
+      if (Exosite_GetCIK(NULL))
+      {
+        // a CIK kept from an earlier activation or configured by hand, use it
+        sendString("== Exosite CIK from flash ==\r\n");
+        cloud_status = 0;
+      }
+      else
+      {
+        // Initialize an Exosite connection
+        sendString("== Exosite Activate ==\r\n");
+        configFlag |= BIT9;
+        cloud_status = Exosite_Activate() ? 0 : 1;
+      }
       ipInfoFlagSet = 0;
 
     }
@@ -440,6 +510,321 @@ checkWiFiConnected(void)
   return FALSE;
 } //checkWifiConnected
 
+//*****************************************************************************
+//
+//!  applyControls
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Applies the control alias values last read from Exosite
+//
+//*****************************************************************************
+void
+applyControls(void)
+{
+  if (ctrlTable[DGR_CTRL].len)
+	{
+      if (!strncmp(ctrlValue[DGR_CTRL], "0", 1))
+      {
+    	  flag ^= BIT8; //LCD Display in Fahrenheit
+      }
+      else if (!strncmp(ctrlValue[DGR_CTRL], "1", 1))
+      {
+    	  flag |= BIT8; //LCD Display in Celsius
+      }
+	}
+  if (ctrlTable[THR_CTRL].len)
+	{
+	exoTempThr = atoi(ctrlValue[THR_CTRL]);
+	  if(exoTempThr != exoTempThrPrev)
+	  {
+		flag |= BIT1;
+		sendString("\tTemperature Threshold updated.\r\n");
+	  }
+	exoTempThrPrev = exoTempThr;
+	}
+  if (ctrlTable[TIMER_CTRL].len)
+	{
+	  exoTimer = atol(ctrlValue[TIMER_CTRL]); //NOTE: limited to 65536 or 6hr55min36sec
+	  if (exoTimer != exoTimerPrev)
+	  {
+		flag |= BIT2;
+		sendString("\tCountdown Timer updated.\r\n");
+	  }
+	exoTimerPrev = exoTimer;
+	}
+} //applyControls
+
+//*****************************************************************************
+//
+//!  recordSample
+//!
+//!  \param  None
+//!
+//!  \return nonzero until the window has been sampled for SAMPLE_WINDOW s
+//!
+//!  \brief  Adds the current sensor readings that are due under their
+//!          publish policy to the sample window. Called after each reading;
+//!          a window out of room goes to the log.
+//
+//*****************************************************************************
+unsigned char
+recordSample(void)
+{
+  unsigned char sensorCount;
+  unsigned long now = logUptime();
+
+  if (SAMPLE_WINDOW <= windowReadings)
+	  windowReadings = 0;	// the last window is out or kept, start the next
+  windowReadings++;
+  if (windowCount + SENSOR_END > WINDOW_RECORDS)
+  {
+	  if (windowSent)
+	  {
+		  // the window is being uploaded, this reading goes to the log alone
+		  for (sensorCount = 0; sensorCount < SENSOR_END; sensorCount++)
+		  {
+			  if (publishDue(sensorCount, now))
+				  logAppend(sensorCount, sensorValue[sensorCount], now);
+		  }
+		  return 0;
+	  }
+	  logSample();
+  }
+  for (sensorCount = 0; sensorCount < SENSOR_END; sensorCount++)
+  {
+	  if (!publishDue(sensorCount, now))
+		  continue;
+	  window[windowCount].timestamp = now;
+	  window[windowCount].alias = sensorNames[sensorCount];
+	  window[windowCount].value = sensorValue[sensorCount];
+	  windowCount++;
+  }
+  return windowReadings < SAMPLE_WINDOW;
+} //recordSample
+
+//*****************************************************************************
+//
+//!  publishDue
+//!
+//!  \param  sensor - index into sensorValue and sensorNames
+//!          now - uptime of the reading
+//!
+//!  \return 1 if the reading goes out; 0 if it is held back
+//!
+//!  \brief  Applies the publish policy of the sensor to its current reading
+//!          and takes it as the last published if it is due
+//
+//*****************************************************************************
+unsigned char
+publishDue(unsigned char sensor, unsigned long now)
+{
+  const publishPolicy * policy = &sensorPolicy[sensor];
+  int value = sensorValue[sensor];
+  unsigned long elapsed = now - publishedAt[sensor];
+  long change = (long)value - publishedValue[sensor];
+  long band;
+
+  if (published[sensor])
+  {
+	  if (elapsed < policy->minInterval)
+		  return 0;
+	  if (elapsed < policy->heartbeat)
+	  {
+		  band = labs(publishedValue[sensor]) * policy->percent / 100;
+		  if (band < policy->deadband)
+			  band = policy->deadband;
+		  if (labs(change) <= band)
+			  return 0;
+	  }
+  }
+  published[sensor] = 1;
+  publishedValue[sensor] = value;
+  publishedAt[sensor] = now;
+  return 1;
+} //publishDue
+
+//*****************************************************************************
+//
+//!  waitSetpoint
+//!
+//!  \param  None
+//!
+//!  \return 1 if the wait ended normally; 0 if it failed
+//!
+//!  \brief  Long-polls thr_ctrl until the sample window is full, sampling on
+//!          meanwhile. The server can hold a request on one alias only, so
+//!          the other controls still come back with the window write. If the
+//!          server answers at once with the value it had, it doesn't support
+//!          long-poll and the demo falls back to sampling with the radio off.
+//
+//*****************************************************************************
+int
+waitSetpoint(void)
+{
+  int result = -1;
+  unsigned long timeout;
+  unsigned long since = 0;
+
+  // hold the request until the window is due
+  timeout = (unsigned long)(SAMPLE_WINDOW - windowReadings) * 1000;
+  if (logClockValid())
+	  since = logUnixTime(logUptime());
+  if (Exosite_WaitAsync(&ctrlTable[THR_CTRL], timeout, setpointSince, setpointWritten, &result))
+  {
+	  while (Exosite_Poll())
+	  {
+		  ads1118Tick();
+	  }
+  }
+  if (0 > result)
+	  return 0;
+  setpointSince = since;
+  return 1;
+} //waitSetpoint
+
+//*****************************************************************************
+//
+//!  setpointWritten
+//!
+//!  \param  result - 1 if thr_ctrl was written, 0 if the wait timed out, -1
+//!          on failure
+//!          ctx - int receiving result
+//!
+//!  \return None
+//!
+//!  \brief  Completion callback of the setpoint wait
+//
+//*****************************************************************************
+void
+setpointWritten(int result, void * ctx)
+{
+  *(int *)ctx = result;
+  if (0 >= result)
+	  return;
+  if (0 == setpointSince && atoi(ctrlValue[THR_CTRL]) == exoTempThrPrev)
+  {
+	  // nothing to wait for yet was answered at once
+	  sendString("\tLong-poll not supported.\r\n");
+	  longPoll = 0;
+  }
+  sendString("== Exosite Setpoint==\r\n");
+  applyControls();
+} //setpointWritten
+
+//*****************************************************************************
+//
+//!  windowWritten
+//!
+//!  \param  found - aliases read back, -1 if the window was not written
+//!          ctx - int receiving found
+//!
+//!  \return None
+//!
+//!  \brief  Completion callback of the window upload. Applies the controls
+//!          read back and drops the records written; readings taken during
+//!          the upload move to the front of the window.
+//
+//*****************************************************************************
+void
+windowWritten(int found, void * ctx)
+{
+  unsigned char i;
+
+  if (0 < found)
+  {
+	  applyControls();
+  }
+  if (0 > found)
+  {
+	  // back to uptime for the log
+	  for (i = 0; i < windowSent; i++)
+		  window[i].timestamp -= logUnixTime(0);
+  }
+  else
+  {
+	  windowCount -= windowSent;
+	  memmove(window, &window[windowSent], windowCount * sizeof(window[0]));
+  }
+  windowSent = 0;
+  *(int *)ctx = found;
+} //windowWritten
+
+//*****************************************************************************
+//
+//!  logSample
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Moves the readings of the sample window to the sample log, when
+//!          they could not be written to Exosite
+//
+//*****************************************************************************
+void
+logSample(void)
+{
+  unsigned char i;
+  char strRead[6];
+
+  if (!windowCount)
+	  return;
+  // the aliases of the window point into sensorNames
+  for (i = 0; i < windowCount; i++)
+  {
+	  logAppend((window[i].alias - sensorNames[0]) / sizeof(sensorNames[0]),
+	            window[i].value, window[i].timestamp);
+  }
+  windowCount = 0;
+  sendString("\tReadings logged, to upload: ");
+  itoa(logPending(), strRead, 10);
+  sendString(strRead);
+  sendString("\r\n");
+} //logSample
+
+//*****************************************************************************
+//
+//!  retryWait
+//!
+//!  \param  None
+//!
+//!  \return ms to wait before the next cycle
+//!
+//!  \brief  Reports the retry backoff of the Exosite library after a failed
+//!          request and waits it out, but no longer than RETRY_WAIT_MAX so
+//!          the readings go on. Requests made while the backoff lasts fail
+//!          at once without using the radio.
+//
+//*****************************************************************************
+int
+retryWait(void)
+{
+  exosite_retry_stats retry;
+  char strRead[6];
+  unsigned char failureClass;
+
+  exosite_retry_read(&retry);
+  if (retry.wait > RETRY_WAIT_MAX)
+	  retry.wait = RETRY_WAIT_MAX;
+  sendString("\tRetry in ms: ");
+  itoa((int)retry.wait, strRead, 10);
+  sendString(strRead);
+  sendString(", failures tcp/noauth/conflict: ");
+  for (failureClass = 0; failureClass < EXO_RETRY_END; failureClass++)
+  {
+	  if (failureClass)
+		  sendString("/");
+	  itoa(retry.failures[failureClass], strRead, 10);
+	  sendString(strRead);
+  }
+  sendString("\r\n");
+
+  return (int)retry.wait;
+} //retryWait
+
 /*****************************************************************************
 *
 *  show_status
@@ -483,6 +868,12 @@ void show_status(void)
     case EXO_STATUS_NOAUTH:
     	_nop();
       break;
+    case EXO_STATUS_BACKOFF:
+    	_nop();
+      break;
+    case EXO_STATUS_TOO_LONG:
+    	_nop();
+      break;
   }
   return;
 } //show_status
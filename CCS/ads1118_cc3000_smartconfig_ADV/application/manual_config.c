@@ -3,33 +3,12 @@
 #include "string.h"
 #include "utils.h"
 #include "../exosite/exosite.h"
+#include "config_store.h"
 
 // local
-void printNetworkInfo(char passPASS[], int flashAddr, int sizePASS, int fwiMax);
-void writeNetworkInfo(int flashAddr, int bytesAvailMax);//(char passPASS[], int flashAddr, int sizePASS, int fwiMax);
-void write_Flash();
-void read_Flash(char *);
-// Flash write
-unsigned int fwi;
-char configValue;
-char * Flash_ptr;                         // Initialize Flash pointer
-// Arrays for network information
-char passTemp[42];
-char passCIK[42];
-char passSSID[32];
-char passPASS[32];
-char passSECU[1];
-char passMAC[12];
-char passDEVNAME[32];
-char passMODNAME[32];
-// Pointers to arrays of network information
-int PTRpassSSID = 0x1800;
-int PTRpassPASS = 0x1820;
-int PTRpassSECU = 0x1840;
-int PTRpassMAC = 0x1850;
-int PTRpassCIK = 0x1880;
-int PTRpassDEVNAME = 0x1900;
-int PTRpassMODNAME = 0x1920;
+void writeNetworkInfo(char * field, int bytesAvailMax);
+// Passphrase shown masked
+char passTemp[33];
 
 //external
 extern void sendString(char * msg);
@@ -43,9 +22,9 @@ extern int configFlag;
  /*
  Bit0 = user has already configured network settings
  Bit1 = UART RX interrupt has received input from COM port
- Bit2 = erase flash memory section for network credentials
- Bit3 = erase flash memory section for CIK
- Bit4 = erase flash memory section for Device/Model Names
+ Bit2 = (unused)
+ Bit3 = (unused)
+ Bit4 = (unused)
  Bit5 = ignore UART RX return character
  Bit6 = expiration timer for dynamic prompt pending
  Bit7 = expiration timer for waiting to connect to access point or smartConfig button push (null by default)
@@ -56,24 +35,6 @@ extern int configFlag;
  */
 
 #ifdef EN_COM_CONFIG
-//*****************************************************************************
-//
-//!  initNetworkConfig
-//!
-//!  \param  None
-//!
-//!  \return None
-//!
-//!  \brief  Read MAC from Flash due to dynamic network configuration
-//
-//*****************************************************************************
-void initNetworkInitRead(char passPASS[], int flashAddr, int sizePASS)
-{
-	  bytesAvail = sizePASS;			//12;
-	  Flash_ptr = (char *) flashAddr;	//0x1850;
-	  read_Flash(passPASS);
-}
-
 //*****************************************************************************
 //
 //!  initNetworkConfig
@@ -91,60 +52,55 @@ void initNetworkConfig()
 	 // Check if user has already configured network settings
 	 if (!(configFlag & BIT0)) 		// If so, skip manual network configuration
 	 {								// If not, enter manual network configuration
+		const network_config * config = configActive();
+		network_config * draft;
+
 	 sendString("\tStarting Dynamic Network Configuration...\r\n");
 	 //Does user have previously stored network configuration information from previous run?
 		sendString("\tUser has previously stored network credentials of:\r\n");
 
 		sendString("\t\tCIK:\t\t");
-		printNetworkInfo(passCIK, PTRpassCIK, sizeof(passCIK), 40);
-		sendString(passCIK);
-		passCIK[40] = '\r';
-		passCIK[41] = '\n';
-		memcpy((char*)USER_CIK, passCIK, 43);
+		sendString((char *)config->cik);
+		memcpy((char*)USER_CIK, config->cik, 40);
+		USER_CIK[40] = '\r';
+		USER_CIK[41] = '\n';
+		USER_CIK[42] = 0;
 
 		sendString("\r\n\t\tDEVICE NAME:\t");
-	  	printNetworkInfo(passDEVNAME, PTRpassDEVNAME, sizeof(passDEVNAME), 32);
-		sendString(passDEVNAME);
+		sendString((char *)config->devname);
 
 		sendString("\r\n\t\tMODEL NAME:\t");
-		printNetworkInfo(passMODNAME, PTRpassMODNAME, sizeof(passMODNAME), 32);
-		sendString(passMODNAME);
+		sendString((char *)config->modname);
 
 		sendString("\r\n\t\tSSID:\t\t");
-		printNetworkInfo(passSSID, PTRpassSSID, sizeof(passSSID), 32);
-		sendString(passSSID);
+		sendString((char *)config->ssid);
 
 		sendString("\r\n\t\tPASSPHRASE:\t");
-		printNetworkInfo(passPASS, PTRpassPASS, sizeof(passPASS), 32);
-		if (fwi>0)
-		{
-			memset(passTemp,'*',fwi);
-		}
+		memset(passTemp, 0, sizeof(passTemp));
+		memset(passTemp, '*', strlen(config->pass));
 		sendString(passTemp);
 
 		sendString("\r\n\t\tSECURITY:\t");
-		printNetworkInfo(passSECU, PTRpassSECU, sizeof(passSECU), 8);
-		if (passSECU[0] == '0')
+		if (config->secu[0] == '0')
 		{
 			sendString("UNSEC");
 		}
-		else if (passSECU[0] == '1')
+		else if (config->secu[0] == '1')
 		{
 			sendString("WEP");
 		}
-		else if (passSECU[0] == '2')
+		else if (config->secu[0] == '2')
 		{
 			sendString("WPA");
 		}
-		else if (passSECU[0] == '3')
+		else if (config->secu[0] == '3')
 		{
 			sendString("WPA2");
 		}
 		else;
 
 		sendString("\r\n\t\tMAC ADDRESS:\t");
-		printNetworkInfo(passMAC, PTRpassMAC, sizeof(passMAC), 16);
-		sendString(passMAC);
+		sendString((char *)config->mac);
 
 	sendString("\r\n\tUpdate Settings? (y/n)\r\n\t");
 	while((configChoice!='n') && (configChoice!='y'))
@@ -154,6 +110,8 @@ void initNetworkConfig()
 		configFlag &= ~BIT6;
 			if (configChoice=='y')
 			{
+				// the answers go into a draft, written in one go at the end
+				draft = configDraft();
 				configChoice='.';
 				sendString("\r\n\tUpdate Exosite CIK? (y/n)\r\n\t");
 				while((configChoice!='n') && (configChoice!='y'))
@@ -162,9 +120,9 @@ void initNetworkConfig()
 					configFlag &= ~BIT1;
 						if (configChoice=='y')
 						{
-							configFlag |= BIT3; //Erase flash memory section for CIK
 							sendString("\r\n\tEnter CIK:\r\n\t");
-							writeNetworkInfo(PTRpassCIK, 40);
+							writeNetworkInfo(draft->cik, 40);
+							Exosite_ClearCIK();		// the CIK entered replaces the activated one
 							break;
 						}
 						else if(configChoice=='n')
@@ -185,11 +143,10 @@ void initNetworkConfig()
 					configFlag &= ~BIT1;
 						if (configChoice=='y')
 						{
-							configFlag |= BIT4; //Erase flash memory section for Dev/Model Names
 							sendString("\r\n\tEnter Device Name:\r\n\t");
-							writeNetworkInfo(PTRpassDEVNAME, 16);
+							writeNetworkInfo(draft->devname, 16);
 							sendString("\r\n\tEnter Model Name:\r\n\t");
-							writeNetworkInfo(PTRpassMODNAME, 32);
+							writeNetworkInfo(draft->modname, 32);
 							break;
 						}
 						else if(configChoice=='n')
@@ -211,11 +168,10 @@ void initNetworkConfig()
 					configFlag &= ~BIT1;
 						if (configChoice=='y')
 						{
-							configFlag |= BIT2; //Erase flash memory section for network credentials
 							sendString("\r\n\tEnter SSID:\r\n\t");
-							writeNetworkInfo(PTRpassSSID, 32);
+							writeNetworkInfo(draft->ssid, 32);
 							sendString("\r\n\tEnter PASSPHRASE:\r\n\t");
-							writeNetworkInfo(PTRpassPASS, 32);
+							writeNetworkInfo(draft->pass, 32);
 
 							sendString("\r\n\tEnter SECURITY: (0=WLAN_SEC_UNSEC, 1=WLAN_SEC_WEP, 2=WLAN_SEC_WPA, 3=WLAN_SEC_WPA2)\r\n\t");
 							bytesAvail=0;
@@ -228,11 +184,8 @@ void initNetworkConfig()
 								uartRXBuf[0] = configChoice;
 									if((configChoice=='0') || (configChoice=='1') || (configChoice=='2') || (configChoice=='3'))
 									{
-										Flash_ptr = (char *) PTRpassSECU;
-										_disable_interrupt();
-										write_Flash();
-										_enable_interrupt();
-										//writeNetworkInfo(PTRpassSECU); //FACTORY ONLY
+										draft->secu[0] = configChoice;
+										draft->secu[1] = 0;
 									}
 									else
 									{
@@ -259,24 +212,14 @@ void initNetworkConfig()
 					while (!(configFlag & BIT1));
 					configFlag &= ~BIT1;
 					memset(uartRXBuf, 0, 50);
-					Flash_ptr = (char *) 0x1850;
 						if (configChoice=='y')
 						{
 							sendString("\r\n\tEnter MAC ADDRESS:\r\n\t");
-							writeNetworkInfo(PTRpassMAC, 12);
+							writeNetworkInfo(draft->mac, 12);
 							break;
 						}
 						else if(configChoice=='n')
 						{
-							//Rewrite previous MAC address
-							for(fwi = 0; fwi < sizeof(passMAC); fwi++)
-							{
-								uartRXBuf[fwi] = passMAC[fwi];
-							}
-							bytesAvail = 12;
-							_disable_interrupt();
-							write_Flash();
-							_enable_interrupt();
 							break;
 						}
 						else
@@ -284,7 +227,10 @@ void initNetworkConfig()
 							sendString("\b");
 						}
 				}
-				sendString("\r\n\tCredentials have been updated.\r\n");
+				if (configCommit())
+					sendString("\r\n\tCredentials have been updated.\r\n");
+				else
+					sendString("\r\n\tCredentials could not be stored!\r\n");
 				configChoice='y';
 				busyWait(100);
 				restartMSP430();
@@ -305,118 +251,19 @@ void initNetworkConfig()
 }
 
 //------------------------------------------------------------------------------
-// Print previously stored network configuration info
-//------------------------------------------------------------------------------
-void printNetworkInfo(char passPASS[], int flashAddr, int sizePASS, int fwiMax)
-{
-	memset(passPASS, 0, sizePASS);
-	Flash_ptr = (char *) flashAddr;
-	for (fwi = 0; fwi < fwiMax; fwi++)
-	{
-		configValue = *Flash_ptr;
-		if(configValue =='') //equivalent to HEX=0xFF, DEC=13)
-		{
-			break;
-		}
-		passPASS[fwi] = configValue;
-		*Flash_ptr++;
-	}
-}
-
-//------------------------------------------------------------------------------
-// Write network configuration info
+// Take network configuration info typed in into a field of the draft
 //------------------------------------------------------------------------------
-void writeNetworkInfo(int flashAddr, int bytesAvailMax)
+void writeNetworkInfo(char * field, int bytesAvailMax)
 {
 	memset(uartRXBuf, 0, 50);
-	memset(passTemp, 0, 42);
 	bytesAvail=0;
 	while (((!(configFlag & BIT1)) || (configChoice!=13)) && !(bytesAvail>=bytesAvailMax));
 	configFlag &= ~BIT1;
-	memcpy(passTemp,uartRXBuf,bytesAvail);
-	Flash_ptr = (char *) flashAddr;
-	_disable_interrupt();
-	write_Flash();
-	_enable_interrupt();
+	if (bytesAvail > bytesAvailMax)
+		bytesAvail = bytesAvailMax;
+	memcpy(field, uartRXBuf, bytesAvail);
+	field[bytesAvail] = 0;
 	memset(uartRXBuf, 0, 50);
-	memset(passTemp, 0, sizeof(passTemp));
-}
-
-//------------------------------------------------------------------------------
-// Input = value, holds value to write to Seg //Ref p.359
-//------------------------------------------------------------------------------
-void write_Flash()
-{
-  FCTL3 = FWKEY;                            // Clear Lock bit
-  FCTL1 = FWKEY+ERASE;                      // Set Erase bit
-
-  //Erase network credentials
-  if(configFlag & BIT2)
-  {
-	  FCTL1 = FWKEY+ERASE;                      // Set Erase bit
-	  *Flash_ptr = 0;                           // Dummy write to erase Flash seg
-	  configFlag &= ~BIT2;
-  }
-  //Erase CIK
-  if(configFlag & BIT3)
-  {
-	  FCTL1 = FWKEY+ERASE;                      // Set Erase bit
-	  *Flash_ptr = 0;                           // Dummy write to erase Flash seg
-	  configFlag &= ~BIT3;
-  }
-  //Erase Device and Model Names
-  if(configFlag & BIT4)
-  {
-	  FCTL1 = FWKEY+ERASE;                      // Set Erase bit
-	  *Flash_ptr = 0;                           // Dummy write to erase Flash seg
-	  configFlag &= ~BIT4;
-  }
-
-  FCTL1 = FWKEY+WRT;                        // Set WRT bit for write operation
-
-  for (fwi = 0; fwi < bytesAvail; fwi++)
-  {
-	  configValue = uartRXBuf[fwi];
-	  *Flash_ptr++ = configValue;                   // Write value to flash
-  }
-  FCTL1 = FWKEY;                            // Clear WRT bit
-  FCTL3 = FWKEY+LOCK;                       // Set LOCK bit
-}
-
-//------------------------------------------------------------------------------
-// Input = value, holds value to write to Seg //Ref p.359
-//------------------------------------------------------------------------------
-void read_Flash(char * flashBuf)
-{
-  FCTL3 = FWKEY;                            // Clear Lock bit
-
-  //Erase network credentials
-  if(configFlag & BIT2)
-  {
-	  *Flash_ptr = 0;                           // Dummy write to erase Flash seg
-	  configFlag &= ~BIT2;
-  }
-  //Erase CIK
-  if(configFlag & BIT3)
-  {
-	  *Flash_ptr = 0;                           // Dummy write to erase Flash seg
-	  configFlag &= ~BIT3;
-  }
-  //Erase Device and Model Names
-  if(configFlag & BIT4)
-  {
-	  *Flash_ptr = 0;                           // Dummy write to erase Flash seg
-	  configFlag &= ~BIT4;
-  }
-
-  FCTL1 = FWKEY+WRT;                        // Set WRT bit for write operation
-
-  for (fwi = 0; fwi < bytesAvail; fwi++)
-  {
-	  *flashBuf++ = *Flash_ptr++;               // Write value to flash
-  }
-  FCTL1 = FWKEY;                            // Clear WRT bit
-  FCTL3 = FWKEY+LOCK;                       // Set LOCK bit
 }
 
 #endif
@@ -0,0 +1,442 @@
+/*****************************************************************************
+*
+*  sample_log.c - Store-and-forward sample log
+*  Copyright (C) 2014 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Texas Instruments Incorporated nor the names of
+*    its contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include <msp430.h>
+#include "sensors.h"
+#include "flash.h"
+#include "../exosite/exosite.h"
+#include "sample_log.h"
+
+// Samples that could not be written to Exosite are appended to a circular
+// log in flash, each with the time it was taken, and uploaded in batches of
+// timestamped records once the connection is back.
+//
+// The slots in [tail, head) hold the records still to upload, oldest first.
+// The segment holding head is always erased from head on; when head enters
+// the next segment that segment is erased, dropping its old records. Record
+// states are kept in the flags byte, whose bits are only ever cleared, so a
+// record changes state by being programmed again in place.
+
+// externs
+extern volatile unsigned long uptime;
+extern const char sensorNames[10][11];
+
+// local defines
+#define LOG_UNSENT      BIT0    // cleared once uploaded
+#define LOG_THIS_BOOT   BIT1    // cleared at the next boot
+#define LOG_UNIX_TIME   BIT2    // time is unix time, otherwise uptime
+#define LOG_WRITTEN     BIT7    // cleared in every record - empty slots read 0xFF
+#define LOG_EMPTY       0xFF
+#define LOG_FLAGS       7       // offset of the flags byte
+
+typedef struct
+{
+  unsigned long time;           // unix time or uptime in seconds, see flags
+  int value;
+  unsigned char sensor;         // index into sensorNames
+  unsigned char flags;
+} log_record;
+
+// local functions
+unsigned long slotAddress(unsigned int slot);
+unsigned char slotFlags(unsigned int slot);
+void clearFlag(unsigned int slot, unsigned char flag);
+unsigned char datable(unsigned char flags);
+
+// globals
+static unsigned int head = 0;           // next slot to write
+static unsigned int tail = 0;           // oldest record to upload
+static unsigned int pending = 0;        // records to upload
+static unsigned long clockOffset = 0;   // unix time at uptime 0
+static unsigned char clockSynced = 0;
+static unsigned long syncUptime = 0;    // uptime of the last clock sync
+
+//*****************************************************************************
+//
+//!  logInit
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Finds the log head and the records still to upload. Records
+//!          timed by the uptime of an earlier boot are marked as such, their
+//!          time can no longer be worked out.
+//
+//*****************************************************************************
+void
+logInit(void)
+{
+  unsigned int slot;
+  unsigned int i;
+  unsigned char flags;
+
+  // the head is the empty slot following the newest record
+  head = LOG_SLOTS;
+  for (slot = 0; slot < LOG_SLOTS; slot++)
+  {
+    if (LOG_EMPTY == slotFlags(slot)
+        && LOG_EMPTY != slotFlags((0 == slot ? LOG_SLOTS : slot) - 1))
+    {
+      head = slot;
+      break;
+    }
+  }
+  if (LOG_SLOTS == head)
+  {
+    // empty - or not a log yet, start it over
+    head = 0;
+    if (LOG_EMPTY != slotFlags(LOG_SLOTS - 1))
+    {
+      for (i = 0; i < LOG_SEGMENTS; i++)
+        flashEraseSegment(LOG_START + (unsigned long)i * FLASH_SEGMENT_SIZE);
+    }
+  }
+
+  // oldest first, from the slot after the head around to the head
+  tail = head;
+  pending = 0;
+  slot = head;
+  for (i = 0; i < LOG_SLOTS; i++)
+  {
+    flags = slotFlags(slot);
+    if (LOG_EMPTY != flags && (flags & LOG_UNSENT))
+    {
+      if (0 == pending++)
+        tail = slot;
+      if (!(flags & LOG_UNIX_TIME) && (flags & LOG_THIS_BOOT))
+        clearFlag(slot, LOG_THIS_BOOT);
+    }
+    else if (0 != pending)
+    {
+      // only the newest records can be unsent - anything else is stale
+      pending = 0;
+      tail = head;
+    }
+    if (LOG_SLOTS == ++slot)
+      slot = 0;
+  }
+}
+
+//*****************************************************************************
+//
+//!  logAppend
+//!
+//!  \param  sensor - index of the sensor; value - its reading;
+//!          sampleUptime - uptime when the reading was taken
+//!
+//!  \return None
+//!
+//!  \brief  Appends a reading to the log, timed in unix time if the clock
+//!          has been synced, otherwise in uptime
+//
+//*****************************************************************************
+void
+logAppend(unsigned char sensor, int value, unsigned long sampleUptime)
+{
+  log_record record;
+  unsigned int dropped;
+
+  record.time = sampleUptime;
+  record.value = value;
+  record.sensor = sensor;
+  record.flags = (unsigned char)~LOG_WRITTEN;
+  if (clockSynced)
+    record.time += clockOffset;
+  else
+    record.flags &= ~LOG_UNIX_TIME;
+
+  flashWrite(slotAddress(head), &record, LOG_RECORD_SIZE);
+  pending++;
+  if (LOG_SLOTS == ++head)
+    head = 0;
+
+  if (0 == head % LOG_SEGMENT_SLOTS)
+  {
+    // make room in the oldest segment, dropping what is left to upload there
+    if (0 != pending && tail - head < LOG_SEGMENT_SLOTS)
+    {
+      dropped = LOG_SEGMENT_SLOTS - (tail - head);
+      pending -= dropped;
+      tail = head + LOG_SEGMENT_SLOTS;
+      if (LOG_SLOTS == tail)
+        tail = 0;
+    }
+    flashEraseSegment(slotAddress(head));
+  }
+}
+
+//*****************************************************************************
+//
+//!  logPending
+//!
+//!  \param  None
+//!
+//!  \return number of records still to upload
+//!
+//!  \brief  Tells whether there is a backlog to upload
+//
+//*****************************************************************************
+unsigned int
+logPending(void)
+{
+  return pending;
+}
+
+//*****************************************************************************
+//
+//!  logUptime
+//!
+//!  \param  None
+//!
+//!  \return seconds since boot
+//!
+//!  \brief  Reads the uptime counter kept by the 1 second timer interrupt
+//
+//*****************************************************************************
+unsigned long
+logUptime(void)
+{
+  unsigned long now;
+  unsigned short state = __get_interrupt_state();
+
+  __disable_interrupt();
+  now = uptime;
+  __set_interrupt_state(state);
+
+  return now;
+}
+
+//*****************************************************************************
+//
+//!  logSyncClock
+//!
+//!  \param  None
+//!
+//!  \return 1 success; 0 failure
+//!
+//!  \brief  Sets the log clock from the Exosite server time
+//
+//*****************************************************************************
+int
+logSyncClock(void)
+{
+  unsigned long now;
+
+  if (!Exosite_Timestamp(&now))
+    return 0;
+
+  syncUptime = logUptime();
+  clockOffset = now - syncUptime;
+  clockSynced = 1;
+  return 1;
+}
+
+//*****************************************************************************
+//
+//!  logClockValid
+//!
+//!  \param  None
+//!
+//!  \return 1 if uptimes can be turned into unix time; 0 if not
+//!
+//!  \brief  Syncs the log clock if it never was or if the uptime clock may
+//!          have drifted since the last sync
+//
+//*****************************************************************************
+int
+logClockValid(void)
+{
+  if (clockSynced && logUptime() - syncUptime < LOG_RESYNC_INTERVAL)
+    return 1;
+
+  return logSyncClock();
+}
+
+//*****************************************************************************
+//
+//!  logUnixTime
+//!
+//!  \param  sampleUptime - an uptime
+//!
+//!  \return the unix time of the uptime, as far as the clock knows
+//!
+//!  \brief  Converts an uptime to unix time
+//
+//*****************************************************************************
+unsigned long
+logUnixTime(unsigned long sampleUptime)
+{
+  return sampleUptime + clockOffset;
+}
+
+//*****************************************************************************
+//
+//!  logUpload
+//!
+//!  \param  records - staging for the records of a request; size - number
+//!          of records it takes
+//!
+//!  \return number of records uploaded
+//!
+//!  \brief  Uploads the backlog, oldest first, size records per request.
+//!          Stops at the first failed request; the rest stays in the log
+//!          for the next try. Records whose time is unknown are dropped.
+//
+//*****************************************************************************
+int
+logUpload(exosite_record * records, unsigned char size)
+{
+  log_record record;
+  unsigned int slot;
+  unsigned int scanned;
+  unsigned char count;
+  unsigned char done;
+  int uploaded = 0;
+
+  if (0 == pending || !logClockValid())
+    return 0;
+
+  while (0 != pending)
+  {
+    // stage the oldest records
+    count = 0;
+    slot = tail;
+    for (scanned = 0; scanned < pending && count < size; scanned++)
+    {
+      flashRead(slotAddress(slot), &record, LOG_RECORD_SIZE);
+      if (datable(record.flags))
+      {
+        records[count].timestamp = record.time;
+        if (!(record.flags & LOG_UNIX_TIME))
+          records[count].timestamp += clockOffset;
+        records[count].alias = sensorNames[record.sensor];
+        records[count].value = record.value;
+        count++;
+      }
+      if (LOG_SLOTS == ++slot)
+        slot = 0;
+    }
+
+    if (0 != count && !Exosite_WriteRecords(records, count))
+      break;
+
+    // mark the records written, and the undatable ones among them, as sent
+    for (done = 0; 0 != pending; pending--)
+    {
+      if (datable(slotFlags(tail)))
+      {
+        if (count == done)
+          break;
+        done++;
+      }
+      clearFlag(tail, LOG_UNSENT);
+      if (LOG_SLOTS == ++tail)
+        tail = 0;
+    }
+    uploaded += count;
+  }
+
+  return uploaded;
+}
+
+//*****************************************************************************
+//
+//!  slotAddress
+//!
+//!  \param  slot - log slot
+//!
+//!  \return flash address of the slot
+//!
+//!  \brief  Maps a log slot to flash
+//
+//*****************************************************************************
+unsigned long
+slotAddress(unsigned int slot)
+{
+  return LOG_START + (unsigned long)slot * LOG_RECORD_SIZE;
+}
+
+//*****************************************************************************
+//
+//!  slotFlags
+//!
+//!  \param  slot - log slot
+//!
+//!  \return flags byte of the slot, LOG_EMPTY if nothing was written there
+//!
+//!  \brief  Reads the state of a log slot
+//
+//*****************************************************************************
+unsigned char
+slotFlags(unsigned int slot)
+{
+  return flashReadByte(slotAddress(slot) + LOG_FLAGS);
+}
+
+//*****************************************************************************
+//
+//!  clearFlag
+//!
+//!  \param  slot - log slot; flag - flag bit to clear
+//!
+//!  \return None
+//!
+//!  \brief  Clears a flag of a record by programming its flags byte again
+//
+//*****************************************************************************
+void
+clearFlag(unsigned int slot, unsigned char flag)
+{
+  unsigned char flags = slotFlags(slot) & ~flag;
+
+  flashWrite(slotAddress(slot) + LOG_FLAGS, &flags, 1);
+}
+
+//*****************************************************************************
+//
+//!  datable
+//!
+//!  \param  flags - flags byte of a record
+//!
+//!  \return 1 if the unix time of the record can be worked out
+//!
+//!  \brief  Tells apart records timed by the uptime of an earlier boot
+//
+//*****************************************************************************
+unsigned char
+datable(unsigned char flags)
+{
+  return (flags & (LOG_UNIX_TIME | LOG_THIS_BOOT)) ? 1 : 0;
+}
@@ -117,6 +117,14 @@
 
 unsigned long socket_active_status = SOCKET_STATUS_INIT_VAL; 
 
+// Set by SimpleLinkBorrowData: the next data packet is left in the RX buffer
+static unsigned char ucRxDataBorrow = 0;
+// The RX buffer is lent out until SimpleLinkReturnData
+static unsigned char ucRxDataBorrowed = 0;
+
+static tSocketAsyncRequest sAsyncRequests[SOCKET_ASYNC_REQUESTS];
+static long lAsyncHandles = 0;
+
 
 //*****************************************************************************
 //            Prototypes for the static functions
@@ -126,6 +134,13 @@ static long hci_event_unsol_flowcontrol_handler(char *pEvent);
 
 static void update_socket_active_status(char *resp_params);
 
+static tSocketAsyncRequest *hci_async_find(unsigned short usOpcode, long lSd,
+                                           unsigned char ucAwaitData);
+
+static void hci_async_complete(tSocketAsyncRequest *pRequest);
+
+static long hci_async_dispatch(unsigned char *pucReceivedData);
+
 
 //*****************************************************************************
 //
@@ -234,6 +249,8 @@ hci_event_handler(void *pRetParams, unsigned char *from, unsigned char *fromlen)
 	unsigned long retValue32;
   unsigned char * RecvParams;
   unsigned char *RetParams;
+	unsigned char ucPatchRequested;
+	char cPatchRequest[HCI_EVENT_HEADER_SIZE + 1];
 	
 	
 	while (1)
@@ -242,6 +259,15 @@ hci_event_handler(void *pRetParams, unsigned char *from, unsigned char *fromlen)
 		{				
 			pucReceivedData = (tSLInformation.pucReceivedData);
 
+			// A packet for an asynchronous request is finished here as well,
+			// so it isn't lost while this call waits
+			if (hci_async_event_handler(pucReceivedData) == 1)
+			{
+				tSLInformation.usEventOrDataReceived = 0;
+				SpiReleaseRxBuffer();
+				continue;
+			}
+
 			if (*pucReceivedData == HCI_TYPE_EVNT)
 			{
 				// Event Received
@@ -453,21 +479,40 @@ hci_event_handler(void *pRetParams, unsigned char *from, unsigned char *fromlen)
 					STREAM_TO_UINT32((char *)(pucReceivedData + HCI_DATA_HEADER_SIZE), BSD_RECV_FROM_FROMLEN_OFFSET, *(unsigned long *)fromlen);
 					memcpy(from, (pucReceivedData + HCI_DATA_HEADER_SIZE + BSD_RECV_FROM_FROM_OFFSET) ,*fromlen);
 				}
+				
+				if (ucRxDataBorrow)
+				{
+					// Hand out the data where it is, the buffer is released
+					// by SimpleLinkReturnData
+					*(unsigned char **)pRetParams = pucReceivedParams + HCI_DATA_HEADER_SIZE + ucArgsize;
+					ucRxDataBorrow = 0;
+					ucRxDataBorrowed = 1;
+					tSLInformation.usRxDataPending = 0;
+					return NULL;
+				}
+				
 				memcpy(pRetParams, pucReceivedParams + HCI_DATA_HEADER_SIZE + ucArgsize, usLength - ucArgsize);
 
 				tSLInformation.usRxDataPending = 0;
 			}
 		
+			// Since we are going to TX - we need to handle this event after the 
+			// release since we need interrupts. The released slot may be read
+			// into or delivered again right away, so keep a copy of the request
+			ucPatchRequested = ((*pucReceivedData == HCI_TYPE_EVNT) &&
+					(usReceivedEventOpcode == HCI_EVNT_PATCHES_REQ));
+			if (ucPatchRequested)
+			{
+				memcpy(cPatchRequest, pucReceivedData, sizeof(cPatchRequest));
+			}
+			
 			tSLInformation.usEventOrDataReceived = 0;
 			
-			SpiResumeSpi();
+			SpiReleaseRxBuffer();
 			
-			// Since we are going to TX - we need to handle this event after the 
-			// ResumeSPi since we need interrupts
-			if ((*pucReceivedData == HCI_TYPE_EVNT) &&
-					(usReceivedEventOpcode == HCI_EVNT_PATCHES_REQ))
+			if (ucPatchRequested)
 			{
-				hci_unsol_handle_patch_request((char *)pucReceivedData);
+				hci_unsol_handle_patch_request(cPatchRequest);
 			}
 			
 			if ((tSLInformation.usRxEventOpcode == 0) && (tSLInformation.usRxDataPending == 0))
@@ -654,7 +699,15 @@ hci_unsolicited_event_handler(void)
 	{
 		pucReceivedData = (tSLInformation.pucReceivedData);
 		
-		if (*pucReceivedData == HCI_TYPE_EVNT)
+		// A packet for an asynchronous request is finished here as well
+		if (hci_async_event_handler(pucReceivedData) == 1)
+		{
+			tSLInformation.usEventOrDataReceived = 0;
+			
+			res = 1;
+			SpiReleaseRxBuffer();
+		}
+		else if (*pucReceivedData == HCI_TYPE_EVNT)
 		{			
 			
 			// In case unsolicited event received - here the handling finished
@@ -666,7 +719,7 @@ hci_unsolicited_event_handler(void)
 				tSLInformation.usEventOrDataReceived = 0;
 				
 				res = 1;
-				SpiResumeSpi();
+				SpiReleaseRxBuffer();
 			}
 		}
 	}
@@ -831,6 +884,394 @@ SimpleLinkWaitData(unsigned char *pBuf, unsigned char *from,
 	hci_event_handler(pBuf, from, fromlen);
 }
 
+//*****************************************************************************
+//
+//!  SimpleLinkBorrowData
+//!
+//!  @param  pData      receives where the data starts
+//!
+//!  @return               none
+//!
+//!  @brief                Wait for data like SimpleLinkWaitData, but leave it
+//!                        in the SPI RX buffer instead of copying it out. The
+//!                        buffer stays with the caller until
+//!                        SimpleLinkReturnData; no other command may be
+//!                        waited on meanwhile.
+//
+//*****************************************************************************
+
+void 
+SimpleLinkBorrowData(unsigned char **pData)
+{
+	ucRxDataBorrow = 1;
+	tSLInformation.usRxDataPending = 1;
+	hci_event_handler(pData, 0, 0);
+}
+
+//*****************************************************************************
+//
+//!  SimpleLinkReturnData
+//!
+//!  @param  none
+//!
+//!  @return               none
+//!
+//!  @brief                Gives back the SPI RX buffer taken by
+//!                        SimpleLinkBorrowData
+//
+//*****************************************************************************
+
+void 
+SimpleLinkReturnData(void)
+{
+	if (ucRxDataBorrowed)
+	{
+		ucRxDataBorrowed = 0;
+		tSLInformation.usEventOrDataReceived = 0;
+		SpiReleaseRxBuffer();
+	}
+}
+
+//*****************************************************************************
+//
+//!  hci_async_request
+//!
+//!  @param  usOpcode    event that completes the request
+//!  @param  lSd         socket of the request
+//!  @param  pfCallback  called with the handle and the result on completion
+//!  @param  pCtx        passed to pfCallback
+//!
+//!  @return             the request, its lHandle set; NULL if all
+//!                      SOCKET_ASYNC_REQUESTS are in flight
+//!
+//!  @brief              Takes a slot for an asynchronous socket request. It
+//!                      has to be taken before the command is sent, since
+//!                      the event may come at any time after.
+//
+//*****************************************************************************
+
+tSocketAsyncRequest *
+hci_async_request(unsigned short usOpcode, long lSd, tSocketAsyncCB pfCallback,
+                  void *pCtx)
+{
+	tSocketAsyncRequest *pRequest = NULL;
+	unsigned short state;
+	unsigned char i;
+	
+	state = __get_interrupt_state();
+	__disable_interrupt();
+	
+	for (i = 0; i < SOCKET_ASYNC_REQUESTS; i++)
+	{
+		if (sAsyncRequests[i].lHandle == 0)
+		{
+			pRequest = &sAsyncRequests[i];
+			break;
+		}
+	}
+	
+	if (pRequest)
+	{
+		// Handles only grow, so the smallest one is the oldest request
+		if (++lAsyncHandles <= 0)
+		{
+			lAsyncHandles = 1;
+		}
+		
+		memset(pRequest, 0, sizeof(tSocketAsyncRequest));
+		pRequest->lHandle = lAsyncHandles;
+		pRequest->usOpcode = usOpcode;
+		pRequest->lSd = lSd;
+		pRequest->pfCallback = pfCallback;
+		pRequest->pCtx = pCtx;
+	}
+	
+	__set_interrupt_state(state);
+	
+	return pRequest;
+}
+
+//*****************************************************************************
+//
+//!  hci_async_cancel
+//!
+//!  @param  pRequest    request from hci_async_request
+//!
+//!  @return             none
+//!
+//!  @brief              Frees the slot of a request whose command could not
+//!                      be sent
+//
+//*****************************************************************************
+
+void
+hci_async_cancel(tSocketAsyncRequest *pRequest)
+{
+	unsigned short state;
+	
+	state = __get_interrupt_state();
+	__disable_interrupt();
+	pRequest->lHandle = 0;
+	__set_interrupt_state(state);
+}
+
+//*****************************************************************************
+//
+//!  hci_async_find
+//!
+//!  @param  usOpcode     event to match
+//!  @param  lSd          socket to match, -1 for any
+//!  @param  ucAwaitData  match the requests waiting for their data instead
+//!
+//!  @return              the oldest matching request, NULL if none
+//!
+//!  @brief               Looks up the request a packet belongs to
+//
+//*****************************************************************************
+
+static tSocketAsyncRequest *
+hci_async_find(unsigned short usOpcode, long lSd, unsigned char ucAwaitData)
+{
+	tSocketAsyncRequest *pRequest = NULL;
+	unsigned char i;
+	
+	for (i = 0; i < SOCKET_ASYNC_REQUESTS; i++)
+	{
+		if ((sAsyncRequests[i].lHandle != 0) &&
+				(sAsyncRequests[i].usOpcode == usOpcode) &&
+				(sAsyncRequests[i].ucAwaitData == ucAwaitData) &&
+				((lSd < 0) || (sAsyncRequests[i].lSd == lSd)) &&
+				((pRequest == NULL) || (sAsyncRequests[i].lHandle < pRequest->lHandle)))
+		{
+			pRequest = &sAsyncRequests[i];
+		}
+	}
+	
+	return pRequest;
+}
+
+//*****************************************************************************
+//
+//!  hci_async_complete
+//!
+//!  @param  pRequest    request whose results are stored
+//!
+//!  @return             none
+//!
+//!  @brief              Frees the slot and calls the callback. The slot is
+//!                      freed first so that the callback sees the request
+//!                      done.
+//
+//*****************************************************************************
+
+static void
+hci_async_complete(tSocketAsyncRequest *pRequest)
+{
+	long lHandle = pRequest->lHandle;
+	
+	pRequest->lHandle = 0;
+	
+	if (pRequest->pfCallback)
+	{
+		pRequest->pfCallback(lHandle, pRequest->lResult, pRequest->pCtx);
+	}
+}
+
+//*****************************************************************************
+//
+//!  hci_async_event_handler
+//!
+//!  @param  pucReceivedData  received event or data packet
+//!
+//!  @return             1 if the packet completed (or continued) an
+//!                      asynchronous request, 0 if it belongs to no request
+//!
+//!  @brief              Matches a packet to an asynchronous request by its
+//!                      opcode, and by its socket for the events that name
+//!                      one; otherwise the oldest request for the opcode
+//!                      gets it, as the CC3000 answers in order. The results
+//!                      are stored and the callback called, from the event
+//!                      handler and so mostly from the SPI interrupt;
+//!                      always with interrupts disabled.
+//
+//*****************************************************************************
+
+long
+hci_async_event_handler(unsigned char *pucReceivedData)
+{
+	unsigned short state;
+	long res;
+	
+	// Also called from the main loop, so keep the SPI interrupt out
+	state = __get_interrupt_state();
+	__disable_interrupt();
+	res = hci_async_dispatch(pucReceivedData);
+	__set_interrupt_state(state);
+	
+	return res;
+}
+
+//*****************************************************************************
+//
+//!  hci_async_dispatch
+//!
+//!  @param  pucReceivedData  received event or data packet
+//!
+//!  @return             as hci_async_event_handler
+//!
+//!  @brief              Body of hci_async_event_handler, run with
+//!                      interrupts disabled
+//
+//*****************************************************************************
+
+static long
+hci_async_dispatch(unsigned char *pucReceivedData)
+{
+	tSocketAsyncRequest *pRequest;
+	unsigned char *pucReceivedParams;
+	unsigned short usReceivedEventOpcode;
+	unsigned short usLength;
+	unsigned char ucArgsize;
+	unsigned long ulValue;
+	long lSd;
+	
+	if (*pucReceivedData == HCI_TYPE_DATA)
+	{
+		// Data follows the receive event of the request waiting for it
+		pRequest = hci_async_find(HCI_EVNT_RECV, -1, 1);
+		if (pRequest == NULL)
+		{
+			return 0;
+		}
+		
+		STREAM_TO_UINT8((char *)pucReceivedData, HCI_PACKET_ARGSIZE_OFFSET, ucArgsize);
+		STREAM_TO_UINT16((char *)pucReceivedData, HCI_PACKET_LENGTH_OFFSET, usLength);
+		
+		usLength -= ucArgsize;
+		if (usLength > pRequest->lLen)
+		{
+			usLength = pRequest->lLen;
+		}
+		
+		memcpy(pRequest->pOut[0], pucReceivedData + HCI_DATA_HEADER_SIZE + ucArgsize, usLength);
+		pRequest->lResult = usLength;
+		hci_async_complete(pRequest);
+		
+		return 1;
+	}
+	
+	if (*pucReceivedData != HCI_TYPE_EVNT)
+	{
+		return 0;
+	}
+	
+	STREAM_TO_UINT16((char *)pucReceivedData, HCI_EVENT_OPCODE_OFFSET, usReceivedEventOpcode);
+	pucReceivedParams = pucReceivedData + HCI_EVENT_HEADER_SIZE;
+	
+	switch(usReceivedEventOpcode)
+	{
+	case HCI_EVNT_CONNECT:
+	case HCI_EVNT_CLOSE_SOCKET:
+		{
+			pRequest = hci_async_find(usReceivedEventOpcode, -1, 0);
+			if (pRequest == NULL)
+			{
+				return 0;
+			}
+			
+			STREAM_TO_UINT32((char *)pucReceivedParams, 0, pRequest->lResult);
+			
+			// since 'close' call may result in either OK (and then it closed) or 
+			// error mark this socket as invalid 
+			if (usReceivedEventOpcode == HCI_EVNT_CLOSE_SOCKET)
+			{
+				set_socket_active_status(pRequest->lSd, SOCKET_STATUS_INACTIVE);
+			}
+			break;
+		}
+		
+	case HCI_EVNT_RECV:
+	case HCI_EVNT_SEND:
+		{
+			STREAM_TO_UINT32((char *)pucReceivedParams, SL_RECEIVE_SD_OFFSET, lSd);
+			pRequest = hci_async_find(usReceivedEventOpcode, lSd, 0);
+			if (pRequest == NULL)
+			{
+				return 0;
+			}
+			
+			STREAM_TO_UINT32((char *)pucReceivedParams, SL_RECEIVE_NUM_BYTES_OFFSET, pRequest->lResult);
+			
+			if (pRequest->lResult == ERROR_SOCKET_INACTIVE)
+			{
+				set_socket_active_status(lSd, SOCKET_STATUS_INACTIVE);
+			}
+			
+			// The data comes in its own packet
+			if ((usReceivedEventOpcode == HCI_EVNT_RECV) && (pRequest->lResult > 0))
+			{
+				pRequest->ucAwaitData = 1;
+				return 1;
+			}
+			break;
+		}
+		
+	case HCI_EVNT_SELECT:
+		{
+			pRequest = hci_async_find(usReceivedEventOpcode, -1, 0);
+			if (pRequest == NULL)
+			{
+				return 0;
+			}
+			
+			STREAM_TO_UINT32((char *)pucReceivedParams, SELECT_STATUS_OFFSET, pRequest->lResult);
+			
+			// Update actually read FD
+			if (pRequest->lResult >= 0)
+			{
+				if (pRequest->pOut[0])
+				{
+					STREAM_TO_UINT32((char *)pucReceivedParams, SELECT_READFD_OFFSET, ulValue);
+					memcpy(pRequest->pOut[0], &ulValue, sizeof(ulValue));
+				}
+				
+				if (pRequest->pOut[1])
+				{
+					STREAM_TO_UINT32((char *)pucReceivedParams, SELECT_WRITEFD_OFFSET, ulValue);
+					memcpy(pRequest->pOut[1], &ulValue, sizeof(ulValue));
+				}
+				
+				if (pRequest->pOut[2])
+				{
+					STREAM_TO_UINT32((char *)pucReceivedParams, SELECT_EXFD_OFFSET, ulValue);
+					memcpy(pRequest->pOut[2], &ulValue, sizeof(ulValue));
+				}
+			}
+			break;
+		}
+		
+	case HCI_EVNT_BSD_GETHOSTBYNAME:
+		{
+			pRequest = hci_async_find(usReceivedEventOpcode, -1, 0);
+			if (pRequest == NULL)
+			{
+				return 0;
+			}
+			
+			STREAM_TO_UINT32((char *)pucReceivedParams, GET_HOST_BY_NAME_RETVAL_OFFSET, pRequest->lResult);
+			STREAM_TO_UINT32((char *)pucReceivedParams, GET_HOST_BY_NAME_ADDR_OFFSET, *(unsigned long *)pRequest->pOut[0]);
+			break;
+		}
+		
+	default:
+		return 0;
+	}
+	
+	hci_async_complete(pRequest);
+	
+	return 1;
+}
+
 //*****************************************************************************
 //
 // Close the Doxygen group.
@@ -83,6 +83,18 @@
 
 #define HCI_CMND_SEND_ARG_LENGTH	(16)
 
+// The largest data length one SEND packet can carry in the TX buffer: the 
+// buffer less the headers, the SEND arguments, a possible padding byte and 
+// the overrun detection magic number
+#define HCI_CMND_SEND_MAX_DATA_LENGTH	(CC3000_TX_BUFFER_SIZE - HEADERS_SIZE_DATA \
+                                         - HCI_CMND_SEND_ARG_LENGTH - 2)
+
+// The largest message recv_peek() asks for: what one data packet can carry 
+// in the RX buffer, with the receive arguments, room for a source address, 
+// a possible padding byte and the overrun detection magic number
+#define SOCKET_RECV_MAX_DATA_LENGTH	(CC3000_RX_BUFFER_SIZE - HEADERS_SIZE_DATA \
+                                     - SOCKET_RECV_FROM_PARAMS_LEN - sizeof(sockaddr) - 2)
+
 
 #define SELECT_TIMEOUT_MIN_MICRO_SECONDS  5000
 
@@ -215,23 +227,22 @@ socket(long domain, long type, long protocol)
 
 //*****************************************************************************
 //
-//! closesocket
+//!  closesocket_command
 //!
-//!  @param  sd    socket handle.
+//!  @param  sd         socket handle
 //!
-//!  @return  On success, zero is returned. On error, -1 is returned.
+//!  @return   none
 //!
-//!  @brief  The socket function closes a created socket.
+//!  @brief    Sends the close command of closesocket() and
+//!            closesocket_async()
 //
 //*****************************************************************************
 
-long
-closesocket(long sd)
+static void
+closesocket_command(long sd)
 {
-	long ret;
 	unsigned char *ptr, *args;
 	
-	ret = EFAIL;
 	ptr = tSLInformation.pucTxCommandBuffer;
 	args = (ptr + HEADERS_SIZE_CMD);
 	
@@ -241,6 +252,27 @@ closesocket(long sd)
 	// Initiate a HCI command
 	hci_command_send(HCI_CMND_CLOSE_SOCKET,
 									 ptr, SOCKET_CLOSE_PARAMS_LEN);
+}
+
+//*****************************************************************************
+//
+//! closesocket
+//!
+//!  @param  sd    socket handle.
+//!
+//!  @return  On success, zero is returned. On error, -1 is returned.
+//!
+//!  @brief  The socket function closes a created socket.
+//
+//*****************************************************************************
+
+long
+closesocket(long sd)
+{
+	long ret;
+	
+	ret = EFAIL;
+	closesocket_command(sd);
 	
 	// Since we are in blocking state - wait for event complete
 	SimpleLinkWaitEvent(HCI_CMND_CLOSE_SOCKET, &ret);
@@ -440,6 +472,39 @@ listen(long sd, long backlog)
 	return(ret);
 }
 
+#ifndef CC3000_TINY_DRIVER
+//*****************************************************************************
+//
+//!  gethostbyname_command
+//!
+//!  @param  hostname   host name
+//!  @param  usNameLen  name length
+//!
+//!  @return   none
+//!
+//!  @brief    Sends the lookup command of gethostbyname() and
+//!            gethostbyname_async()
+//
+//*****************************************************************************
+
+static void
+gethostbyname_command(char * hostname, unsigned short usNameLen)
+{
+	unsigned char *ptr, *args;
+	
+	ptr = tSLInformation.pucTxCommandBuffer;
+	args = (ptr + SIMPLE_LINK_HCI_CMND_TRANSPORT_HEADER_SIZE);
+	
+	// Fill in HCI packet structure
+	args = UINT32_TO_STREAM(args, 8);
+	args = UINT32_TO_STREAM(args, usNameLen);
+	ARRAY_TO_STREAM(args, hostname, usNameLen);
+	
+	// Initiate a HCI command
+	hci_command_send(HCI_CMND_GETHOSTNAME, ptr, SOCKET_GET_HOST_BY_NAME_PARAMS_LEN
+									 + usNameLen - 1);
+}
+
 //*****************************************************************************
 //
 //! gethostbyname
@@ -459,13 +524,11 @@ listen(long sd, long backlog)
 //
 //*****************************************************************************
 
-#ifndef CC3000_TINY_DRIVER
 int 
 gethostbyname(char * hostname, unsigned short usNameLen, 
 							unsigned long* out_ip_addr)
 {
 	tBsdGethostbynameParams ret;
-	unsigned char *ptr, *args;
 	
 	errno = EFAIL;
 	
@@ -474,17 +537,7 @@ gethostbyname(char * hostname, unsigned short usNameLen,
 		return errno;
 	}
 	
-	ptr = tSLInformation.pucTxCommandBuffer;
-	args = (ptr + SIMPLE_LINK_HCI_CMND_TRANSPORT_HEADER_SIZE);
-	
-	// Fill in HCI packet structure
-	args = UINT32_TO_STREAM(args, 8);
-	args = UINT32_TO_STREAM(args, usNameLen);
-	ARRAY_TO_STREAM(args, hostname, usNameLen);
-	
-	// Initiate a HCI command
-	hci_command_send(HCI_CMND_GETHOSTNAME, ptr, SOCKET_GET_HOST_BY_NAME_PARAMS_LEN
-									 + usNameLen - 1);
+	gethostbyname_command(hostname, usNameLen);
 	
 	// Since we are in blocking state - wait for event complete
 	SimpleLinkWaitEvent(HCI_EVNT_BSD_GETHOSTBYNAME, &ret);
@@ -498,6 +551,41 @@ gethostbyname(char * hostname, unsigned short usNameLen,
 }
 #endif
 
+//*****************************************************************************
+//
+//!  connect_command
+//!
+//!  @param  sd         socket handle
+//!  @param  addr       destination address
+//!
+//!  @return   none
+//!
+//!  @brief    Sends the connect command of connect() and
+//!            connect_async()
+//
+//*****************************************************************************
+
+static void
+connect_command(long sd, const sockaddr *addr)
+{
+	unsigned char *ptr, *args;
+	long addrlen;
+	
+	ptr = tSLInformation.pucTxCommandBuffer;
+	args = (ptr + SIMPLE_LINK_HCI_CMND_TRANSPORT_HEADER_SIZE);
+	addrlen = 8;
+	
+	// Fill in temporary command buffer
+	args = UINT32_TO_STREAM(args, sd);
+	args = UINT32_TO_STREAM(args, 0x00000008);
+	args = UINT32_TO_STREAM(args, addrlen);
+	ARRAY_TO_STREAM(args, ((unsigned char *)addr), addrlen);
+	
+	// Initiate a HCI command
+	hci_command_send(HCI_CMND_CONNECT,
+									 ptr, SOCKET_CONNECT_PARAMS_LEN);
+}
+
 //*****************************************************************************
 //
 //! connect
@@ -531,22 +619,9 @@ long
 connect(long sd, const sockaddr *addr, long addrlen)
 {
 	long int ret;
-	unsigned char *ptr, *args;
 	
 	ret = EFAIL;
-	ptr = tSLInformation.pucTxCommandBuffer;
-	args = (ptr + SIMPLE_LINK_HCI_CMND_TRANSPORT_HEADER_SIZE);
-	addrlen = 8;
-	
-	// Fill in temporary command buffer
-	args = UINT32_TO_STREAM(args, sd);
-	args = UINT32_TO_STREAM(args, 0x00000008);
-	args = UINT32_TO_STREAM(args, addrlen);
-	ARRAY_TO_STREAM(args, ((unsigned char *)addr), addrlen);
-	
-	// Initiate a HCI command
-	hci_command_send(HCI_CMND_CONNECT,
-									 ptr, SOCKET_CONNECT_PARAMS_LEN);
+	connect_command(sd, addr);
 	
 	// Since we are in blocking state - wait for event complete
 	SimpleLinkWaitEvent(HCI_CMND_CONNECT, &ret);
@@ -559,48 +634,26 @@ connect(long sd, const sockaddr *addr, long addrlen)
 
 //*****************************************************************************
 //
-//! select
-//!
-//!  @param[in]   nfds       the highest-numbered file descriptor in any of the
-//!                           three sets, plus 1.     
-//!  @param[out]   writesds   socket descriptors list for write monitoring
-//!  @param[out]   readsds    socket descriptors list for read monitoring  
-//!  @param[out]   exceptsds  socket descriptors list for exception monitoring
-//!  @param[in]   timeout     is an upper bound on the amount of time elapsed
-//!                           before select() returns. Null means infinity 
-//!                           timeout. The minimum timeout is 5 milliseconds,
-//!                          less than 5 milliseconds will be set
-//!                           automatically to 5 milliseconds.
-//!  @return  	On success, select() returns the number of file descriptors
-//!             contained in the three returned descriptor sets (that is, the
-//!             total number of bits that are set in readfds, writefds,
-//!             exceptfds) which may be zero if the timeout expires before
-//!             anything interesting  happens.
-//!             On error, -1 is returned.
-//!                   *readsds - return the sockets on which Read request will
-//!                              return without delay with valid data.
-//!                   *writesds - return the sockets on which Write request 
-//!                                 will return without delay.
-//!                   *exceptsds - return the sockets which closed recently.
+//!  select_command
 //!
-//!  @brief  Monitor socket activity  
-//!          Select allow a program to monitor multiple file descriptors,
-//!          waiting until one or more of the file descriptors become 
-//!         "ready" for some class of I/O operation 
+//!  @param  nfds       highest socket plus 1
+//!  @param  readsds    read monitoring list
+//!  @param  writesds   write monitoring list
+//!  @param  exceptsds  exception monitoring list
+//!  @param  timeout    upper bound, NULL for none
 //!
-//!  @Note   If the timeout value set to less than 5ms it will automatically set
-//!          to 5ms to prevent overload of the system
+//!  @return   none
 //!
-//!  @sa socket
+//!  @brief    Sends the select command of select() and
+//!            select_async()
 //
 //*****************************************************************************
 
-int
-select(long nfds, fd_set *readsds, fd_set *writesds, fd_set *exceptsds, 
-       struct timeval *timeout)
+static void
+select_command(long nfds, fd_set *readsds, fd_set *writesds, fd_set *exceptsds, 
+               struct timeval *timeout)
 {
 	unsigned char *ptr, *args;
-	tBsdSelectRecvParams tParams;
 	unsigned long is_blocking;
 	
 	if( timeout == NULL)
@@ -640,6 +693,53 @@ select(long nfds, fd_set *readsds, fd_set *writesds, fd_set *exceptsds,
 	
 	// Initiate a HCI command
 	hci_command_send(HCI_CMND_BSD_SELECT, ptr, SOCKET_SELECT_PARAMS_LEN);
+}
+
+//*****************************************************************************
+//
+//! select
+//!
+//!  @param[in]   nfds       the highest-numbered file descriptor in any of the
+//!                           three sets, plus 1.     
+//!  @param[out]   writesds   socket descriptors list for write monitoring
+//!  @param[out]   readsds    socket descriptors list for read monitoring  
+//!  @param[out]   exceptsds  socket descriptors list for exception monitoring
+//!  @param[in]   timeout     is an upper bound on the amount of time elapsed
+//!                           before select() returns. Null means infinity 
+//!                           timeout. The minimum timeout is 5 milliseconds,
+//!                          less than 5 milliseconds will be set
+//!                           automatically to 5 milliseconds.
+//!  @return  	On success, select() returns the number of file descriptors
+//!             contained in the three returned descriptor sets (that is, the
+//!             total number of bits that are set in readfds, writefds,
+//!             exceptfds) which may be zero if the timeout expires before
+//!             anything interesting  happens.
+//!             On error, -1 is returned.
+//!                   *readsds - return the sockets on which Read request will
+//!                              return without delay with valid data.
+//!                   *writesds - return the sockets on which Write request 
+//!                                 will return without delay.
+//!                   *exceptsds - return the sockets which closed recently.
+//!
+//!  @brief  Monitor socket activity  
+//!          Select allow a program to monitor multiple file descriptors,
+//!          waiting until one or more of the file descriptors become 
+//!         "ready" for some class of I/O operation 
+//!
+//!  @Note   If the timeout value set to less than 5ms it will automatically set
+//!          to 5ms to prevent overload of the system
+//!
+//!  @sa socket
+//
+//*****************************************************************************
+
+int
+select(long nfds, fd_set *readsds, fd_set *writesds, fd_set *exceptsds, 
+       struct timeval *timeout)
+{
+	tBsdSelectRecvParams tParams;
+	
+	select_command(nfds, readsds, writesds, exceptsds, timeout);
 	
 	// Since we are in blocking state - wait for event complete
 	SimpleLinkWaitEvent(HCI_EVNT_SELECT, &tParams);
@@ -838,6 +938,37 @@ getsockopt (long sd, long level, long optname, void *optval, socklen_t *optlen)
 	}
 }
 
+//*****************************************************************************
+//
+//!  recv_command
+//!
+//!  @param  sd         socket handle
+//!  @param  len        most bytes to receive
+//!  @param  flags      indicates blocking or non-blocking operation
+//!  @param  opcode     HCI_CMND_RECV or HCI_CMND_RECVFROM
+//!
+//!  @return   none
+//!
+//!  @brief    Sends the read command of the recv calls
+//
+//*****************************************************************************
+
+static void
+recv_command(long sd, long len, long flags, long opcode)
+{
+	unsigned char *ptr, *args;
+	
+	ptr = tSLInformation.pucTxCommandBuffer;
+	args = (ptr + HEADERS_SIZE_CMD);
+	
+	// Fill in HCI packet structure
+	args = UINT32_TO_STREAM(args, sd);
+	args = UINT32_TO_STREAM(args, len);
+	args = UINT32_TO_STREAM(args, flags);
+	
+	hci_command_send(opcode,  ptr, SOCKET_RECV_FROM_PARAMS_LEN);
+}
+
 //*****************************************************************************
 //
 //!  simple_link_recv
@@ -863,19 +994,10 @@ int
 simple_link_recv(long sd, void *buf, long len, long flags, sockaddr *from,
                 socklen_t *fromlen, long opcode)
 {
-	unsigned char *ptr, *args;
 	tBsdReadReturnParams tSocketReadEvent;
 	
-	ptr = tSLInformation.pucTxCommandBuffer;
-	args = (ptr + HEADERS_SIZE_CMD);
-	
-	// Fill in HCI packet structure
-	args = UINT32_TO_STREAM(args, sd);
-	args = UINT32_TO_STREAM(args, len);
-	args = UINT32_TO_STREAM(args, flags);
-	
 	// Generate the read command, and wait for the 
-	hci_command_send(opcode,  ptr, SOCKET_RECV_FROM_PARAMS_LEN);
+	recv_command(sd, len, flags, opcode);
 	
 	// Since we are in blocking state - wait for event complete
 	SimpleLinkWaitEvent(opcode, &tSocketReadEvent);
@@ -921,6 +1043,76 @@ recv(long sd, void *buf, long len, long flags)
 	return(simple_link_recv(sd, buf, len, flags, NULL, NULL, HCI_CMND_RECV));
 }
 
+//*****************************************************************************
+//
+//!  recv_peek
+//!
+//!  @param[in]  sd     socket handle
+//!  @param[out] ptr    receives where the message starts
+//!  @param[in,out] len most bytes to receive, at most what the SPI RX buffer
+//!                     takes in one packet; receives the bytes at *ptr
+//!
+//!  @return         Return the number of bytes received, or -1 if an error
+//!                  occurred, as recv()
+//!
+//!  @brief          Receives a message like recv(), but leaves it in the SPI
+//!                  RX buffer for the caller to parse in place instead of
+//!                  copying it out. When something was received the buffer
+//!                  is lent to the caller and has to be given back with
+//!                  recv_release() before any other driver call is made.
+//!
+//!  @sa recv_release
+//
+//*****************************************************************************
+
+int
+recv_peek(long sd, unsigned char **ptr, long *len)
+{
+	tBsdReadReturnParams tSocketReadEvent;
+	
+	if (*len > SOCKET_RECV_MAX_DATA_LENGTH)
+	{
+		*len = SOCKET_RECV_MAX_DATA_LENGTH;
+	}
+	
+	recv_command(sd, *len, 0, HCI_CMND_RECV);
+	
+	// Since we are in blocking state - wait for event complete
+	SimpleLinkWaitEvent(HCI_CMND_RECV, &tSocketReadEvent);
+	
+	*len = 0;
+	if (tSocketReadEvent.iNumberOfBytes > 0)
+	{
+		SimpleLinkBorrowData(ptr);
+		*len = tSocketReadEvent.iNumberOfBytes;
+	}
+	
+	errno = tSocketReadEvent.iNumberOfBytes;
+	
+	return(tSocketReadEvent.iNumberOfBytes);
+}
+
+//*****************************************************************************
+//
+//!  recv_release
+//!
+//!  @param[in]  sd     socket handle, as given to recv_peek()
+//!
+//!  @return         none
+//!
+//!  @brief          Gives back the message lent by recv_peek(); the pointer
+//!                  it handed out is no longer valid after this
+//!
+//!  @sa recv_peek
+//
+//*****************************************************************************
+
+void
+recv_release(long sd)
+{
+	SimpleLinkReturnData();
+}
+
 //*****************************************************************************
 //
 //!  recvfrom
@@ -1089,6 +1281,178 @@ send(long sd, const void *buf, long len, long flags)
 	return(simple_link_send(sd, buf, len, flags, NULL, 0, HCI_CMND_SEND));
 }
 
+//*****************************************************************************
+//
+//!  sendv
+//!
+//!  @param sd       socket handle
+//!  @param vec      array of buffers to be sent one after the other
+//!  @param count    number of buffers in vec
+//!  @param flags    On this version, this parameter is not supported
+//!
+//!  @return         Return the number of bytes transmitted, or -1 if an
+//!                  error occurred before anything was transmitted
+//!
+//!  @brief          Write data gathered from several buffers to TCP socket.
+//!                  The buffers are packed into as few SEND packets as the 
+//!                  TX buffer allows, so each packet takes one CC3000 buffer
+//!                  and one SPI transaction however the data is split up.
+//!
+//!  @Note           On this version, only blocking mode is supported.
+//!
+//!  @sa             send
+//
+//*****************************************************************************
+
+int
+sendv(long sd, const iov *vec, long count, long flags)
+{
+	unsigned char *ptr, *pDataPtr, *args;
+	long seg = 0;
+	long offset = 0;
+	long len, part;
+	int total = 0;
+	int res;
+	
+	while (seg < count)
+	{
+		// Skip empty buffers so that no packet goes out without data
+		if (offset == vec[seg].iov_len)
+		{
+			seg++;
+			offset = 0;
+			continue;
+		}
+		
+		if (0 != (res = HostFlowControlConsumeBuff(sd)))
+		{
+			return (total ? total : res);
+		}
+		
+		//Update the number of sent packets
+		tSLInformation.NumberOfSentPackets++;
+		
+		ptr = tSLInformation.pucTxCommandBuffer;
+		pDataPtr = ptr + HEADERS_SIZE_DATA + HCI_CMND_SEND_ARG_LENGTH;
+		
+		// Gather as much data as the packet can carry
+		len = 0;
+		while (seg < count && len < HCI_CMND_SEND_MAX_DATA_LENGTH)
+		{
+			part = vec[seg].iov_len - offset;
+			if (part > HCI_CMND_SEND_MAX_DATA_LENGTH - len)
+			{
+				part = HCI_CMND_SEND_MAX_DATA_LENGTH - len;
+			}
+			memcpy(pDataPtr + len, (const unsigned char *)vec[seg].iov_base + offset, part);
+			len += part;
+			offset += part;
+			if (offset == vec[seg].iov_len)
+			{
+				seg++;
+				offset = 0;
+			}
+		}
+		
+		// Fill in temporary command buffer
+		args = ptr + HEADERS_SIZE_DATA;
+		args = UINT32_TO_STREAM(args, sd);
+		args = UINT32_TO_STREAM(args, HCI_CMND_SEND_ARG_LENGTH - sizeof(sd));
+		args = UINT32_TO_STREAM(args, len);
+		args = UINT32_TO_STREAM(args, flags);
+		
+		// Initiate a HCI command
+		hci_data_send(HCI_CMND_SEND, ptr, HCI_CMND_SEND_ARG_LENGTH, len, NULL, 0);
+		
+		total += len;
+	}
+	
+	return (total);
+}
+
+//*****************************************************************************
+//
+//!  sl_send_reserve
+//!
+//!  @param sd       socket handle
+//!  @param ptr      receives where the data is to be written
+//!  @param maxlen   most bytes the caller wants to write
+//!
+//!  @return         Number of bytes that may be written at *ptr, at most
+//!                  maxlen, or a negative value as for send() if no packet
+//!                  can be sent
+//!
+//!  @brief          Reserves the TX buffer for one SEND packet and hands out
+//!                  its data area, behind the HCI headers, so that the data
+//!                  can be formatted in place rather than copied in by
+//!                  send(). A successful reservation takes one CC3000
+//!                  buffer and has to be followed by sl_send_commit().
+//!
+//!  @Note           The TX buffer is shared by every driver call, so no
+//!                  other call may be made until sl_send_commit().
+//!
+//!  @sa             sl_send_commit
+//
+//*****************************************************************************
+
+long
+sl_send_reserve(long sd, unsigned char **ptr, long maxlen)
+{
+	int res;
+	
+	if (0 != (res = HostFlowControlConsumeBuff(sd)))
+	{
+		return res;
+	}
+	
+	*ptr = tSLInformation.pucTxCommandBuffer + HEADERS_SIZE_DATA + HCI_CMND_SEND_ARG_LENGTH;
+	
+	if (maxlen > HCI_CMND_SEND_MAX_DATA_LENGTH)
+	{
+		maxlen = HCI_CMND_SEND_MAX_DATA_LENGTH;
+	}
+	
+	return (maxlen);
+}
+
+//*****************************************************************************
+//
+//!  sl_send_commit
+//!
+//!  @param sd       socket handle, as given to sl_send_reserve()
+//!  @param len      bytes written at the reserved pointer, at least 1
+//!
+//!  @return         Return the number of bytes transmitted
+//!
+//!  @brief          Sends the data written into the area reserved by
+//!                  sl_send_reserve() as one SEND packet
+//!
+//!  @sa             sl_send_reserve
+//
+//*****************************************************************************
+
+int
+sl_send_commit(long sd, long len)
+{
+	unsigned char *ptr, *args;
+	
+	//Update the number of sent packets
+	tSLInformation.NumberOfSentPackets++;
+	
+	// Fill in temporary command buffer, the data is in place already
+	ptr = tSLInformation.pucTxCommandBuffer;
+	args = ptr + HEADERS_SIZE_DATA;
+	args = UINT32_TO_STREAM(args, sd);
+	args = UINT32_TO_STREAM(args, HCI_CMND_SEND_ARG_LENGTH - sizeof(sd));
+	args = UINT32_TO_STREAM(args, len);
+	args = UINT32_TO_STREAM(args, 0);
+	
+	// Initiate a HCI command
+	hci_data_send(HCI_CMND_SEND, ptr, HCI_CMND_SEND_ARG_LENGTH, len, NULL, 0);
+	
+	return (len);
+}
+
 //*****************************************************************************
 //
 //!  sendto
@@ -1168,3 +1532,279 @@ mdnsAdvertiser(unsigned short mdnsEnabled, char * deviceServiceName, unsigned sh
 	return ret;
 	
 }
+
+//*****************************************************************************
+//
+//!  connect_async
+//!
+//!  @param[in]   sd          socket descriptor (handle)
+//!  @param[in]   addr        specifies the destination addr, as connect()
+//!  @param[in]   addrlen     contains the size of the structure pointed to
+//!                           by addr
+//!  @param[in]   pfCallback  called with the result of connect()
+//!  @param[in]   pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no request slot is
+//!           free
+//!
+//!  @brief  Starts connect() and returns without waiting for the connection
+//!
+//!  @sa connect
+//
+//*****************************************************************************
+
+long
+connect_async(long sd, const sockaddr *addr, long addrlen,
+              tSocketAsyncCB pfCallback, void *pCtx)
+{
+	tSocketAsyncRequest *pRequest;
+	long lHandle;
+	
+	pRequest = hci_async_request(HCI_EVNT_CONNECT, sd, pfCallback, pCtx);
+	if (pRequest == NULL)
+	{
+		return -2;
+	}
+	lHandle = pRequest->lHandle;
+	
+	connect_command(sd, addr);
+	
+	return lHandle;
+}
+
+//*****************************************************************************
+//
+//!  recv_async
+//!
+//!  @param[in]  sd          socket handle
+//!  @param[out] buf         where the message is stored; has to stay valid
+//!                          until the callback
+//!  @param[in]  len         size of buf, at most what the SPI RX buffer takes
+//!                          in one packet
+//!  @param[in]  flags       as recv()
+//!  @param[in]  pfCallback  called with the number of bytes received, or a
+//!                          negative error, as recv() returns
+//!  @param[in]  pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -1 on a bad length, -2 if
+//!           no request slot is free
+//!
+//!  @brief  Starts recv() and returns without waiting for the message
+//!
+//!  @sa recv
+//
+//*****************************************************************************
+
+long
+recv_async(long sd, void *buf, long len, long flags,
+           tSocketAsyncCB pfCallback, void *pCtx)
+{
+	tSocketAsyncRequest *pRequest;
+	long lHandle;
+	
+	if (len <= 0)
+	{
+		return EFAIL;
+	}
+	
+	if (len > SOCKET_RECV_MAX_DATA_LENGTH)
+	{
+		len = SOCKET_RECV_MAX_DATA_LENGTH;
+	}
+	
+	pRequest = hci_async_request(HCI_EVNT_RECV, sd, pfCallback, pCtx);
+	if (pRequest == NULL)
+	{
+		return -2;
+	}
+	lHandle = pRequest->lHandle;
+	pRequest->lLen = len;
+	pRequest->pOut[0] = buf;
+	
+	recv_command(sd, len, flags, HCI_CMND_RECV);
+	
+	return lHandle;
+}
+
+//*****************************************************************************
+//
+//!  send_async
+//!
+//!  @param[in]  sd          socket handle
+//!  @param[in]  buf         message to send, copied before the call returns
+//!  @param[in]  len         message size in bytes
+//!  @param[in]  pfCallback  called with the bytes the CC3000 sent, or a
+//!                          negative error
+//!  @param[in]  pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no CC3000 buffer or
+//!           no request slot is free, other negative values as send()
+//!
+//!  @brief  Sends like send(), but instead of waiting for a free CC3000
+//!          buffer returns -2 for the caller to try again later
+//!
+//!  @sa send
+//
+//*****************************************************************************
+
+long
+send_async(long sd, const void *buf, long len,
+           tSocketAsyncCB pfCallback, void *pCtx)
+{
+	tSocketAsyncRequest *pRequest;
+	long lHandle;
+	int res;
+	
+	if (0 == tSLInformation.usNumberOfFreeBuffers)
+	{
+		return -2;
+	}
+	
+	pRequest = hci_async_request(HCI_EVNT_SEND, sd, pfCallback, pCtx);
+	if (pRequest == NULL)
+	{
+		return -2;
+	}
+	lHandle = pRequest->lHandle;
+	
+	res = simple_link_send(sd, buf, len, 0, NULL, 0, HCI_CMND_SEND);
+	if (res < 0)
+	{
+		hci_async_cancel(pRequest);
+		return res;
+	}
+	
+	return lHandle;
+}
+
+//*****************************************************************************
+//
+//!  select_async
+//!
+//!  @param[in]   nfds        the highest-numbered file descriptor in any of
+//!                           the three sets, plus 1
+//!  @param[out]  readsds     socket descriptors list for read monitoring
+//!  @param[out]  writesds    socket descriptors list for write monitoring
+//!  @param[out]  exceptsds   socket descriptors list for exception monitoring
+//!  @param[in]   timeout     as select()
+//!  @param[in]   pfCallback  called with the number of ready sockets, or the
+//!                           negative error
+//!  @param[in]   pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no request slot is
+//!           free
+//!
+//!  @brief  Starts select() and returns without waiting for the sockets.
+//!          The lists are updated, as select() does, just before the
+//!          callback and have to stay valid until then.
+//!
+//!  @sa select
+//
+//*****************************************************************************
+
+long
+select_async(long nfds, fd_set *readsds, fd_set *writesds, fd_set *exceptsds, 
+             struct timeval *timeout, tSocketAsyncCB pfCallback, void *pCtx)
+{
+	tSocketAsyncRequest *pRequest;
+	long lHandle;
+	
+	pRequest = hci_async_request(HCI_EVNT_SELECT, -1, pfCallback, pCtx);
+	if (pRequest == NULL)
+	{
+		return -2;
+	}
+	lHandle = pRequest->lHandle;
+	pRequest->pOut[0] = readsds;
+	pRequest->pOut[1] = writesds;
+	pRequest->pOut[2] = exceptsds;
+	
+	select_command(nfds, readsds, writesds, exceptsds, timeout);
+	
+	return lHandle;
+}
+
+//*****************************************************************************
+//
+//!  gethostbyname_async
+//!
+//!  @param[in]   hostname     host name
+//!  @param[in]   usNameLen    name length
+//!  @param[out]  out_ip_addr  filled in with the host IP address just before
+//!                            the callback; has to stay valid until then
+//!  @param[in]   pfCallback   called with what gethostbyname() returns
+//!  @param[in]   pCtx         passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -1 if the name is too
+//!           long, -2 if no request slot is free
+//!
+//!  @brief  Starts gethostbyname() and returns without waiting for the DNS
+//!          answer
+//!
+//!  @sa gethostbyname
+//
+//*****************************************************************************
+
+#ifndef CC3000_TINY_DRIVER
+long
+gethostbyname_async(char * hostname, unsigned short usNameLen,
+                    unsigned long* out_ip_addr, tSocketAsyncCB pfCallback,
+                    void *pCtx)
+{
+	tSocketAsyncRequest *pRequest;
+	long lHandle;
+	
+	if (usNameLen > HOSTNAME_MAX_LENGTH)
+	{
+		return EFAIL;
+	}
+	
+	pRequest = hci_async_request(HCI_EVNT_BSD_GETHOSTBYNAME, -1, pfCallback, pCtx);
+	if (pRequest == NULL)
+	{
+		return -2;
+	}
+	lHandle = pRequest->lHandle;
+	pRequest->pOut[0] = out_ip_addr;
+	
+	gethostbyname_command(hostname, usNameLen);
+	
+	return lHandle;
+}
+#endif
+
+//*****************************************************************************
+//
+//!  closesocket_async
+//!
+//!  @param[in]  sd          socket handle
+//!  @param[in]  pfCallback  called with what closesocket() returns
+//!  @param[in]  pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no request slot is
+//!           free
+//!
+//!  @brief  Starts closesocket() and returns without waiting for the socket
+//!          to close. The socket is marked inactive when it completes.
+//!
+//!  @sa closesocket
+//
+//*****************************************************************************
+
+long
+closesocket_async(long sd, tSocketAsyncCB pfCallback, void *pCtx)
+{
+	tSocketAsyncRequest *pRequest;
+	long lHandle;
+	
+	pRequest = hci_async_request(HCI_EVNT_CLOSE_SOCKET, sd, pfCallback, pCtx);
+	if (pRequest == NULL)
+	{
+		return -2;
+	}
+	lHandle = pRequest->lHandle;
+	
+	closesocket_command(sd);
+	
+	return lHandle;
+}
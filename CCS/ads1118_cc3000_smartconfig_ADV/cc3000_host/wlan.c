@@ -92,7 +92,7 @@ unsigned char profileArray[SMART_CONFIG_PROFILE_SIZE];
 #define WLAN_CONNECT_PARAM_LEN					(29)
 #define WLAN_SMART_CONFIG_START_PARAMS_LEN		(4)
 
-extern char spi_buffer[CC3000_RX_BUFFER_SIZE];
+extern char spi_buffer[CC3000_RX_SLOTS][CC3000_RX_BUFFER_SIZE];
 
 
 //*****************************************************************************
@@ -257,6 +257,7 @@ wlan_start(unsigned short usPatchesAvailableAtHost)
 {
 	
 	unsigned long ulSpiIRQState;
+	unsigned char ucSlot;
 	
 	tSLInformation.NumberOfSentPackets = 0;
 	tSLInformation.NumberOfReleasedPackets = 0;
@@ -299,7 +300,10 @@ wlan_start(unsigned short usPatchesAvailableAtHost)
 		}
 	}
 
-	spi_buffer[130] = 0xDE;  		//FACTORY ONLY
+	for (ucSlot = 0; ucSlot < CC3000_RX_SLOTS; ucSlot++)
+	{
+		spi_buffer[ucSlot][130] = 0xDE;	//FACTORY ONLY
+	}
 	wlan_tx_buffer[130] = 0xDE;		//FACTORY ONLY
 
 	SimpleLink_Init_Start(usPatchesAvailableAtHost);
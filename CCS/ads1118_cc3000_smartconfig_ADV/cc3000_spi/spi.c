@@ -71,6 +71,13 @@
 #define 	eSPI_STATE_READ_FIRST_PORTION	 (7)
 #define 	eSPI_STATE_READ_EOT				 (8)
 
+// Transfers of at least SPI_DMA_MIN bytes are moved by DMA: channel 0 drains
+// UCB0RXBUF, channel 1 feeds UCB0TXBUF and the completion interrupt ends the
+// transfer. Below that the channel setup costs more than polling the bytes.
+#define SPI_DMA_MIN             (16)
+#define SPI_DMA_RX_TRIGGER      DMA0TSEL_18     // UCB0RXIFG
+#define SPI_DMA_TX_TRIGGER      DMA1TSEL_19     // UCB0TXIFG
+
 typedef struct
 {
 	gcSpiHandleRx  SPIRxHandler;
@@ -80,6 +87,15 @@ typedef struct
 	unsigned char *pTxPacket;
 	unsigned char *pRxPacket;
 
+	// RX pool: the ISR fills spi_buffer[ucRxFill] while the HCI layer
+	// works on spi_buffer[ucRxTail], the oldest of ucRxQueued full slots
+	unsigned char  ucRxFill;
+	unsigned char  ucRxTail;
+	unsigned char  ucRxQueued;
+	unsigned char  ucRxHeld;        // tail slot is with the HCI layer
+	unsigned char  ucRxFull;        // IRQ paused until a slot is released
+	unsigned char  ucRxDelivering;
+
 }tSpiInformation;
 
 
@@ -91,14 +107,17 @@ unsigned char tSpiReadHeader[] = {READ, 0, 0, 0, 0};
 
 
 void SpiWriteDataSynchronous(unsigned char *data, unsigned short size);
+void SpiReadDataSynchronous(unsigned char *data, unsigned short size);
+long SpiWriteData(unsigned char *data, unsigned short size);
+long SpiReadData(unsigned char *data, unsigned short size);
+void SpiDmaStart(unsigned char *rx, unsigned char *tx, unsigned short size);
 void SpiWriteAsync(const unsigned char *data, unsigned short size);
 void SpiPauseSpi(void);
 void SpiResumeSpi(void);
 void SSIContReadOperation(void);
+void SpiRxDeliver(void);
 extern void SpiReceiveHandler(void *pvBuffer);
 
-extern char exo_buffer[200];
-
 // The magic number that resides at the end of the TX/RX buffer (1 byte after
 // the allocated size) for the purpose of detection of the overrun. The location
 // of the memory where the magic number resides shall never be written. In case 
@@ -115,9 +134,9 @@ extern char exo_buffer[200];
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #ifdef __CCS__
-char spi_buffer[CC3000_RX_BUFFER_SIZE];
+char spi_buffer[CC3000_RX_SLOTS][CC3000_RX_BUFFER_SIZE];
 #elif __IAR_SYSTEMS_ICC__
-__no_init char spi_buffer[CC3000_RX_BUFFER_SIZE];
+__no_init char spi_buffer[CC3000_RX_SLOTS][CC3000_RX_BUFFER_SIZE];
 #endif
 
 #ifdef __CCS__
@@ -163,6 +182,9 @@ SpiClose(void)
 	{
 		sSpiInformation.pRxPacket = 0;
 	}
+	sSpiInformation.ucRxQueued = 0;
+	sSpiInformation.ucRxHeld = 0;
+	sSpiInformation.ucRxFull = 0;
 	
 	//	Disable Interrupt
 	tSLInformation.WlanInterruptDisable();
@@ -183,15 +205,25 @@ SpiClose(void)
 void 
 SpiOpen(gcSpiHandleRx pfRxHandler)
 {
+	unsigned char i;
+	
 	sSpiInformation.ulSpiState = eSPI_STATE_POWERUP;
 	spiRTXCalibration();
 	sSpiInformation.SPIRxHandler = pfRxHandler;
 	sSpiInformation.usTxPacketLength = 0;
 	sSpiInformation.pTxPacket = NULL;
+	sSpiInformation.ucRxFill = 0;
+	sSpiInformation.ucRxTail = 0;
+	sSpiInformation.ucRxQueued = 0;
+	sSpiInformation.ucRxHeld = 0;
+	sSpiInformation.ucRxFull = 0;
+	sSpiInformation.ucRxDelivering = 0;
 	spiRTXCalibration();
-	sSpiInformation.pRxPacket = (unsigned char *)spi_buffer;
 	sSpiInformation.usRxPacketLength = 0;
-	spi_buffer[CC3000_RX_BUFFER_SIZE - 1] = CC3000_BUFFER_MAGIC_NUMBER;
+	for (i = 0; i < CC3000_RX_SLOTS; i++)
+	{
+		spi_buffer[i][CC3000_RX_BUFFER_SIZE - 1] = CC3000_BUFFER_MAGIC_NUMBER;
+	}
 	wlan_tx_buffer[CC3000_TX_BUFFER_SIZE - 1] = CC3000_BUFFER_MAGIC_NUMBER;
 	
 	// Enable interrupt on WLAN IRQ pin 
@@ -326,6 +358,9 @@ SpiWrite(unsigned char *pUserBuffer, unsigned short usLength)
 		//again to not IDLE due to IRQ
 		tSLInformation.WlanInterruptDisable();
 		
+		// A read may still be finishing by DMA
+		SpiWaitTransfer();
+		
 		//TODO: resolve error during network connection
 //		while (sSpiInformation.ulSpiState != eSPI_STATE_IDLE)
 //		{
@@ -346,16 +381,18 @@ SpiWrite(unsigned char *pUserBuffer, unsigned short usLength)
 		// check for a missing interrupt between the CS assertion and enabling back the interrupts
 		if (tSLInformation.ReadWlanInterruptPin() == 0)
 		{
-			SpiWriteDataSynchronous(sSpiInformation.pTxPacket, sSpiInformation.usTxPacketLength);
-			
-			sSpiInformation.ulSpiState = eSPI_STATE_IDLE;
-			
-			DEASSERT_CS();
+			if (!SpiWriteData(sSpiInformation.pTxPacket, sSpiInformation.usTxPacketLength))
+			{
+				sSpiInformation.ulSpiState = eSPI_STATE_IDLE;
+				
+				DEASSERT_CS();
+			}
 		}
 	}
 	
 	// Due to the fact that we are currently implementing a blocking situation
-	// here we will wait till end of transaction
+	// here we will wait till end of transaction (a DMA write ends in
+	// IntSpiDMAHandler)
 	while (eSPI_STATE_IDLE != sSpiInformation.ulSpiState)
 		;
 	
@@ -389,6 +426,106 @@ SpiWriteDataSynchronous(unsigned char *data, unsigned short size)
 	}
 }
 
+//*****************************************************************************
+//
+//!  SpiWriteData
+//!
+//!  @param  data  buffer to write
+//!  @param  size  buffer's size
+//!
+//!  @return 1 if the write was handed to DMA and is still in flight, 0 if
+//!          it completed here
+//!
+//!  @brief  Spi write operation. A long write is moved by DMA and finished
+//!          by IntSpiDMAHandler, which idles the state and releases CS.
+//
+//*****************************************************************************
+long
+SpiWriteData(unsigned char *data, unsigned short size)
+{
+	if (size < SPI_DMA_MIN)
+	{
+		SpiWriteDataSynchronous(data, size);
+		return(0);
+	}
+	
+	sSpiInformation.ulSpiState = eSPI_STATE_WRITE_FIRST_PORTION;
+	SpiDmaStart(NULL, data, size);
+	return(1);
+}
+
+//*****************************************************************************
+//
+//!  SpiReadData
+//!
+//!  @param  data  buffer to read
+//!  @param  size  buffer's size
+//!
+//!  @return 1 if the read was handed to DMA and is still in flight, 0 if
+//!          it completed here
+//!
+//!  @brief  Spi read operation. A long read is moved by DMA and finished
+//!          by IntSpiDMAHandler, which hands the packet on for processing.
+//
+//*****************************************************************************
+long
+SpiReadData(unsigned char *data, unsigned short size)
+{
+	if (size < SPI_DMA_MIN)
+	{
+		SpiReadDataSynchronous(data, size);
+		return(0);
+	}
+	
+	sSpiInformation.ulSpiState = eSPI_STATE_READ_FIRST_PORTION;
+	SpiDmaStart(data, tSpiReadHeader, size);
+	return(1);
+}
+
+//*****************************************************************************
+//
+//!  SpiDmaStart
+//!
+//!  @param  rx    buffer to read into, or NULL for a write
+//!  @param  tx    buffer to write; for a read only its first byte is sent,
+//!                as the dummy byte that clocks the data in
+//!  @param  size  transfer size
+//!
+//!  @return none
+//!
+//!  @brief  Arms the DMA channels for one SPI transfer and starts it. The
+//!          interrupt comes from the RX channel for a read and from the TX
+//!          channel for a write.
+//
+//*****************************************************************************
+void
+SpiDmaStart(unsigned char *rx, unsigned char *tx, unsigned short size)
+{
+	UCB0RXBUF;                                  // drop any stale byte
+	DMACTL0 = SPI_DMA_RX_TRIGGER + SPI_DMA_TX_TRIGGER;
+	
+	__data16_write_addr((unsigned short)&DMA1SA, (unsigned long)tx);
+	__data16_write_addr((unsigned short)&DMA1DA, (unsigned long)&UCB0TXBUF);
+	DMA1SZ = size;
+	
+	if (rx)
+	{
+		__data16_write_addr((unsigned short)&DMA0SA, (unsigned long)&UCB0RXBUF);
+		__data16_write_addr((unsigned short)&DMA0DA, (unsigned long)rx);
+		DMA0SZ = size;
+		DMA0CTL = DMADT_0 + DMADSTINCR_3 + DMASBDB + DMAIE + DMAEN;
+		DMA1CTL = DMADT_0 + DMASBDB + DMAEN;
+	}
+	else
+	{
+		DMA1CTL = DMADT_0 + DMASRCINCR_3 + DMASBDB + DMAIE + DMAEN;
+	}
+	
+	// TX is already empty, so the trigger edge has to be made by hand
+	UCB0IFG &= ~UCTXIFG;
+	UCB0IFG |= UCTXIFG;
+}
+
 //*****************************************************************************
 //
 //! SpiReadDataSynchronous
@@ -452,13 +589,14 @@ SpiReadHeader(void)
 long
 SpiReadDataCont(void)
 {
-	long data_to_recv;
+	long data_to_recv, pending;
 	unsigned char *evnt_buff, type;
 	
 	//determine what type of packet we have
 	spiRTXCalibration();
 	evnt_buff =  sSpiInformation.pRxPacket;
 	data_to_recv = 0;
+	pending = 0;
 	STREAM_TO_UINT8((char *)(evnt_buff + SPI_HEADER_SIZE), HCI_PACKET_TYPE_OFFSET,
 									type);
 	
@@ -476,7 +614,7 @@ SpiReadDataCont(void)
 			
 			if (data_to_recv)
 			{
-				SpiReadDataSynchronous(evnt_buff + 10, data_to_recv);
+				pending = SpiReadData(evnt_buff + 10, data_to_recv);
 			}
 			break;
 		}
@@ -496,15 +634,18 @@ SpiReadDataCont(void)
 			
 			if (data_to_recv)
 			{
-				SpiReadDataSynchronous(evnt_buff + 10, data_to_recv);
+				pending = SpiReadData(evnt_buff + 10, data_to_recv);
 			}
 			
-			sSpiInformation.ulSpiState = eSPI_STATE_READ_EOT;
+			if (!pending)
+			{
+				sSpiInformation.ulSpiState = eSPI_STATE_READ_EOT;
+			}
 			break;
 		}
 	}
 	
-	return (0);
+	return (pending);
 }
 
 
@@ -527,6 +668,35 @@ SpiPauseSpi(void)
 }
 
 
+//*****************************************************************************
+//
+//! SpiWaitTransfer
+//!
+//!  @param  none
+//!
+//!  @return none
+//!
+//!  @brief  Waits out a DMA transfer still in flight, so that the SPI can
+//!          be lent to another device. Leaves the IRQ paused: a read that
+//!          completes meanwhile may release an RX slot and resume it, in
+//!          which case it is paused again and the wait repeated.
+//
+//*****************************************************************************
+
+void 
+SpiWaitTransfer(void)
+{
+	do
+	{
+		SpiPauseSpi();
+		while (sSpiInformation.ulSpiState == eSPI_STATE_READ_FIRST_PORTION ||
+			   sSpiInformation.ulSpiState == eSPI_STATE_WRITE_FIRST_PORTION)
+			;
+	}
+	while (SPI_IRQ_IE & SPI_IRQ_PIN);
+}
+
+
 //*****************************************************************************
 //
 //! SpiResumeSpi
@@ -554,7 +724,9 @@ SpiResumeSpi(void)
 //!
 //!  @return none
 //!
-//!  @brief  Spi RX processing 
+//!  @brief  Spi RX processing. The packet just read is queued and the next
+//!          slot is made the one to read into; the IRQ is only paused when
+//!          no free slot is left.
 //
 //*****************************************************************************
 void 
@@ -562,7 +734,6 @@ SpiTriggerRxProcessing(void)
 {
 	
 	// Trigger Rx processing
-	SpiPauseSpi();
 	DEASSERT_CS();
 	
 
@@ -577,9 +748,90 @@ SpiTriggerRxProcessing(void)
 	{
 		while (1);
 	}
+	
+	sSpiInformation.ucRxQueued++;
+	sSpiInformation.ucRxFill = (sSpiInformation.ucRxFill + 1) % CC3000_RX_SLOTS;
+	spiRTXCalibration();
+	if (sSpiInformation.ucRxQueued == CC3000_RX_SLOTS)
+	{
+		SpiPauseSpi();
+		sSpiInformation.ucRxFull = 1;
+	}
+	
 	sSpiInformation.ulSpiState = eSPI_STATE_IDLE;
 
-	sSpiInformation.SPIRxHandler(sSpiInformation.pRxPacket + SPI_HEADER_SIZE);
+	SpiRxDeliver();
+}
+
+//*****************************************************************************
+//
+//! SpiRxDeliver
+//!
+//!  @param  none
+//!
+//!  @return none
+//!
+//!  @brief  Hands the oldest queued packet to the HCI layer, if it does not
+//!          hold one already. An unsolicited event is consumed (and its slot
+//!          released) inside the handler, so keep going until a packet is
+//!          held or the queue is empty. Runs with interrupts disabled.
+//
+//*****************************************************************************
+void
+SpiRxDeliver(void)
+{
+	// SpiReleaseRxBuffer called from inside the handler
+	if (sSpiInformation.ucRxDelivering)
+	{
+		return;
+	}
+	
+	sSpiInformation.ucRxDelivering = 1;
+	while (sSpiInformation.ucRxQueued && !sSpiInformation.ucRxHeld)
+	{
+		sSpiInformation.ucRxHeld = 1;
+		sSpiInformation.SPIRxHandler((unsigned char *)spi_buffer[sSpiInformation.ucRxTail] + SPI_HEADER_SIZE);
+	}
+	sSpiInformation.ucRxDelivering = 0;
+}
+
+//*****************************************************************************
+//
+//! SpiReleaseRxBuffer
+//!
+//!  @param  none
+//!
+//!  @return none
+//!
+//!  @brief  Called by the HCI layer when it is done with the packet it was
+//!          handed. The slot is freed, the next queued packet (if any) is
+//!          handed over and a paused IRQ is resumed. The released slot is
+//!          the last one to be read into again.
+//
+//*****************************************************************************
+void
+SpiReleaseRxBuffer(void)
+{
+	unsigned short state = __get_interrupt_state();
+	
+	__disable_interrupt();
+	
+	if (sSpiInformation.ucRxHeld)
+	{
+		sSpiInformation.ucRxHeld = 0;
+		sSpiInformation.ucRxTail = (sSpiInformation.ucRxTail + 1) % CC3000_RX_SLOTS;
+		sSpiInformation.ucRxQueued--;
+	}
+	
+	SpiRxDeliver();
+	
+	if (sSpiInformation.ucRxFull && sSpiInformation.ucRxQueued < CC3000_RX_SLOTS)
+	{
+		sSpiInformation.ucRxFull = 0;
+		SpiResumeSpi();
+	}
+	
+	__set_interrupt_state(state);
 }
 
 //*****************************************************************************
@@ -608,6 +860,15 @@ __interrupt void IntSpiGPIOHandler(void)
 			//on event 
 	 		sSpiInformation.ulSpiState = eSPI_STATE_INITIALIZED;
 		}
+		else if (sSpiInformation.ulSpiState == eSPI_STATE_IDLE &&
+				 sSpiInformation.ucRxQueued == CC3000_RX_SLOTS)
+		{
+			// No free slot, the IRQ was only resumed for a write: leave the
+			// request pending until SpiReleaseRxBuffer resumes it
+			SpiPauseSpi();
+			sSpiInformation.ucRxFull = 1;
+			SPI_IFG_PORT |= SPI_IRQ_PIN;
+		}
 		else if (sSpiInformation.ulSpiState == eSPI_STATE_IDLE)
 		{
 			sSpiInformation.ulSpiState = eSPI_STATE_READ_IRQ;
@@ -624,12 +885,13 @@ __interrupt void IntSpiGPIOHandler(void)
 		}
 		else if (sSpiInformation.ulSpiState == eSPI_STATE_WRITE_IRQ)
 		{
-			SpiWriteDataSynchronous(sSpiInformation.pTxPacket, 
-															sSpiInformation.usTxPacketLength);
-			
-			sSpiInformation.ulSpiState = eSPI_STATE_IDLE;
-			
-			DEASSERT_CS();
+			if (!SpiWriteData(sSpiInformation.pTxPacket, 
+												sSpiInformation.usTxPacketLength))
+			{
+				sSpiInformation.ulSpiState = eSPI_STATE_IDLE;
+				
+				DEASSERT_CS();
+			}
 		}
 		break;
 	default:
@@ -638,6 +900,46 @@ __interrupt void IntSpiGPIOHandler(void)
 	
 }
 
+//*****************************************************************************
+// 
+//!  IntSpiDMAHandler
+//! 
+//!  @param  none
+//! 
+//!  @return none
+//! 
+//!  @brief  DMA interrupt handler. Ends the transfer started by SpiDmaStart:
+//!          a read is handed on for processing, a write releases CS once
+//!          its last byte has left the shift register.
+// 
+//*****************************************************************************
+#pragma vector=DMA_VECTOR
+__interrupt void IntSpiDMAHandler(void)
+{
+	switch(__even_in_range(DMAIV, DMAIV_DMA2IFG))
+	{
+	case DMAIV_DMA0IFG:
+		// The TX channel of a read ran without interrupt
+		DMA1CTL &= ~DMAIFG;
+		
+		sSpiInformation.ulSpiState = eSPI_STATE_READ_EOT;
+		
+		SpiTriggerRxProcessing();
+		break;
+	case DMAIV_DMA1IFG:
+		while (UCB0STAT & UCBUSY)
+			;
+		UCB0RXBUF;
+		
+		sSpiInformation.ulSpiState = eSPI_STATE_IDLE;
+		
+		DEASSERT_CS();
+		break;
+	default:
+		break;
+	}
+}
+
 //*****************************************************************************
 //
 //! SSIContReadOperation
@@ -710,16 +1012,10 @@ long RXBufferIsEmpty(void)
 //*****************************************************************************
 void spiRTXCalibration()
 {
-	//Monitor spi_buffer
-	if (sSpiInformation.pRxPacket != (unsigned char *) spi_buffer)
-	{
-		sSpiInformation.pRxPacket = (unsigned char *) spi_buffer;
-	}
-
-	//Monitor exo_buffer
-	if (sSpiInformation.pTxPacket != (unsigned char *) exo_buffer)
+	//Monitor spi_buffer: the slot being read into
+	if (sSpiInformation.pRxPacket != (unsigned char *) spi_buffer[sSpiInformation.ucRxFill])
 	{
-		sSpiInformation.pTxPacket = (unsigned char *) exo_buffer;
+		sSpiInformation.pRxPacket = (unsigned char *) spi_buffer[sSpiInformation.ucRxFill];
 	}
 
 	//Monitor SpiReceiveHandler
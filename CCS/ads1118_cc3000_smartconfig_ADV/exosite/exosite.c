@@ -35,6 +35,7 @@
 
 #include "exosite_hal.h"
 #include "exosite_meta.h"
+#include "exosite_retry.h"
 #include <string.h>
 #include "exosite.h"
 #include <socket.h>
@@ -45,14 +46,17 @@
 
 
 //local defines
-#define EXOSITE_MAX_CONNECT_RETRY_COUNT 5
 //#define EXOSITE_LENGTH EXOSITE_SN_MAXLENGTH + EXOSITE_MODEL_MAXLENGTH + EXOSITE_VENDOR_MAXLENGTH
 #define EXOSITE_LENGTH 60           // for light weight Exosite library
-#define RX_SIZE 50
+#define RX_SIZE 255         // most bytes asked for per receive, the driver takes what fits
+#define SERVER_TTL (24UL * 3600 * 1000)      // ms a resolved server address is used before it is looked up again
+#define SERVER_LOOKUP_RETRY (60UL * 1000)    // ms before a failed lookup is tried again
+#define ASYNC_RESPONSE_TIMEOUT 10000UL  // ms without data before an asynchronous request is given up
+#define ASYNC_CONNECT_TIMEOUT 10000UL   // ms an asynchronous connect is waited on
+#define REQUEST_RESERVE 0x7FFF    // ask for all of the TX buffer a packet can carry
 #define CIK_LENGTH 40
 #define MAC_LEN 6
 //externs
-extern char passCIK[42];
 
 enum lineTypes
 {
@@ -69,40 +73,250 @@ enum lineTypes
 #define STR_CIK_HEADER "X-Exosite-CIK: "
 #define STR_CONTENT_LENGTH "Content-Length: "
 #define STR_GET_URL "GET /onep:v1/stack/alias?"
-#define STR_HTTP "  HTTP/1.1\r\n"
-#define STR_HOST "Host: m2.exosite.com\r\n" //"Host: m2.exosite.com\r\n"
-#define STR_POST_HEADER "POST /onep:v1/stack/alias HTTP/1.1\r\n"
+#define STR_HTTP " HTTP/1.1\r\n"
+#define STR_SERVER_NAME "m2.exosite.com"
+#define STR_HOST "Host: " STR_SERVER_NAME "\r\n"
+#define STR_POST_URL "POST /onep:v1/stack/alias"
 #define STR_POST_ACTIVATE "POST /provision/activate HTTP/1.1\r\n"
-#define STR_ACCEPT "Accept: application/x-www-form-urlencoded; charset=utf-8\r\n\r\n"
-#define STR_CONTENT "Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n"
+#define STR_CONTENT "Content-Type: application/x-www-form-urlencoded\r\n"
+#define STR_LENGTH_END "    \r\n\r\n"  // room for the Content-Length digits
+#define STR_RPC_HEADER "POST /onep:v1/rpc/process HTTP/1.1\r\n" STR_HOST \
+                       "Content-Type: application/json; charset=utf-8\r\n" STR_CONTENT_LENGTH
+#define STR_RPC_AUTH "{\"auth\":{\"cik\":\""
+#define STR_RPC_CALLS "\"},\"calls\":["
+#define STR_RPC_END "]}"
+#define STR_RPC_ID "{\"id\":"
+#define STR_RECORD_CALL ",\"procedure\":\"record\",\"arguments\":[{\"alias\":\""
+#define STR_RECORD_POINTS "\"},["
+#define STR_RECORD_END "],{}]}"
+#define STR_READ_CALL ",\"procedure\":\"read\",\"arguments\":[{\"alias\":\""
+#define STR_READ_END "\"},{\"limit\":1}]}"
+#define STR_RPC_OK "\"status\":\"ok\""
+#define STR_RPC_RESULT_ID "\"id\":"
+#define STR_RPC_RESULT "\"result\":[["
+#define STR_TIMESTAMP "GET /timestamp HTTP/1.1\r\n" STR_HOST STR_CRLF
 #define STR_VENDOR "vendor="
 #define STR_MODEL "model="
 #define STR_SN "sn="
 #define STR_CRLF "\r\n"
+#define STR_HDR_LENGTH "content-length:"
+#define STR_HDR_CLOSE "connection: close"
+#define STR_HDR_CHUNKED "transfer-encoding: chunked"
+#define STR_REQUEST_TIMEOUT "Request-Timeout: "
+#define STR_IF_MODIFIED_SINCE "If-Modified-Since: "
+
+// Request header templates, rebuilt only when the CIK or the provisioning
+// info changes. Only the Content-Length digits are patched per request.
+//  alias_header:     " HTTP/1.1", Host, X-Exosite-CIK, Content-Type,
+//                    Content-Length - follows the POST request line. The
+//                    first ALIAS_READ_LENGTH bytes also serve a GET.
+//  activate_request: the whole activation request, headers and body
+#define LENGTH_DIGITS 4
+#define LENGTH_MAX 9999                // largest value LENGTH_DIGITS hold
+#define ALIAS_READ_LENGTH (sizeof(STR_HTTP STR_HOST STR_CIK_HEADER) - 1 + CIK_LENGTH + 2)
+#define ALIAS_HEADER_LENGTH (ALIAS_READ_LENGTH + sizeof(STR_CONTENT STR_CONTENT_LENGTH STR_LENGTH_END) - 1)
+#define ACTIVATE_HEADER_LENGTH (sizeof(STR_POST_ACTIVATE STR_HOST STR_CONTENT STR_CONTENT_LENGTH STR_LENGTH_END) - 1)
+#define LENGTH_DIGITS_OFFSET(len) ((len) - (sizeof(STR_LENGTH_END) - 1))
+
+enum serverStates
+{
+  SERVER_UNKNOWN,     // not read from meta yet
+  SERVER_CACHED,      // looked up, or stored by an earlier run
+  SERVER_STALE        // a connect failed, look up again
+};
+
+// receives the response body one character at a time
+typedef void (*body_handler)(void * ctx, char c);
+
+enum httpStates
+{
+  HTTP_STATUS,        // status line
+  HTTP_HEADER,        // header lines
+  HTTP_BODY,          // Content-Length body
+  HTTP_BODY_EOF,      // body ended by the server closing the connection
+  HTTP_CHUNK_SIZE,    // chunk size line
+  HTTP_CHUNK_DATA,
+  HTTP_CHUNK_END,     // CRLF after the chunk data
+  HTTP_TRAILER,       // trailer lines after the last chunk
+  HTTP_DONE,
+  HTTP_ERROR
+};
+
+// resumable HTTP response parser, fed received data in pieces of any size
+typedef struct
+{
+  unsigned char state;
+  int code;                   // status code, 0 until known
+  unsigned char col;          // characters into the current line
+  unsigned char field;        // status line: spaces seen; chunk size: done
+  unsigned char lengthMatch;  // characters of the header names matched
+  unsigned char closeMatch;
+  unsigned char chunkedMatch;
+  unsigned char haveLength;
+  unsigned char keepAlive;
+  unsigned char chunked;
+  unsigned long remaining;    // body or chunk bytes still to come
+  body_handler handler;
+  void * ctx;
+} http_parser;
+
+// collects a response body into a buffer
+typedef struct
+{
+  char * buf;
+  unsigned char size;
+  unsigned char len;
+} body_buffer;
+
+// splits a form-urlencoded "<alias>=<value>&..." body into a value table
+typedef struct
+{
+  exosite_value * table;
+  unsigned char count;
+  unsigned char found;
+  exosite_value * entry;      // entry taking the current value, NULL if none
+  unsigned char inValue;
+  unsigned char keyLen;
+  char key[EXOSITE_ALIAS_MAXLENGTH];
+  unsigned char hexDigits;    // digits of a %XX escape still expected
+  char hexValue;
+} form_parser;
+
+// where an encoding goes: measured only, or added to the request
+typedef struct
+{
+  long sock;                  // -1 to only measure
+  unsigned int len;           // length encoded so far
+} encoder;
+
+enum rpcValueStates
+{
+  RPC_NO_VALUE,
+  RPC_TIMESTAMP,              // in "result":[[<timestamp>,
+  RPC_VALUE                   // in <value>]]
+};
+
+// counts the calls an RPC response reports as ok and takes the values of
+// the read calls into a table
+typedef struct
+{
+  unsigned char okMatch;      // characters of STR_RPC_OK matched
+  unsigned char ok;
+  unsigned char idMatch;
+  unsigned char inId;
+  unsigned char id;           // id of the call being reported
+  unsigned char resultMatch;
+  unsigned char valueState;
+  exosite_value * table;      // entry i takes the result of call firstRead + i
+  unsigned char firstRead;
+  unsigned char count;
+  unsigned char found;
+  exosite_value * entry;
+} rpc_result;
+
+enum asyncKinds
+{
+  ASYNC_RECORDS,              // Exosite_WriteRecordsReadAsync
+  ASYNC_WAIT                  // Exosite_WaitAsync
+};
+
+// the asynchronous request in flight, see Exosite_Poll
+typedef struct
+{
+  unsigned char state;
+  unsigned char kind;
+  unsigned char reused;       // sent on a kept-alive connection
+  unsigned long lastData;     // exoHAL_GetMillis() the connect was started, the request sent or data came
+  unsigned long patience;     // ms without data before it is given up
+  long sock;
+  const exosite_record * records;
+  unsigned char count;
+  unsigned char calls;
+  char length[sizeof(STR_LENGTH_END)];
+  rpc_result result;
+  exosite_value * value;      // ASYNC_WAIT: the alias waited on
+  unsigned long timeout;
+  unsigned long since;
+  form_parser form;
+  http_parser http;
+  exosite_callback done;
+  void * ctx;
+} async_request;
 
 // local functions
 int info_assemble(const char * vendor, const char *model, const char *sn);
 int init_UUID(unsigned char if_nbr);
 void update_m2ip(void);
-int get_http_status(long socket);
+void build_alias_header(void);
+int cik_valid(const char * pCIK);
+void load_cik(void);
+int set_content_length(char * pdigits, unsigned int len);
+int post_records(const exosite_record * records, unsigned char count, rpc_result * result);
+int records_length(char * length, const exosite_record * records, unsigned char count, rpc_result * result);
+unsigned char send_records(long sock, const char * length, const exosite_record * records, unsigned char count, rpc_result * result);
+int records_status(int http_status, unsigned char calls, rpc_result * result);
+int async_start(unsigned char kind, exosite_callback done, void * ctx);
+void send_wait(long sock, exosite_value * value, unsigned long timeout, unsigned long since);
+void async_receive(void);
+void async_end(void);
+void async_finish(int result);
+void clear_values(exosite_value * table, unsigned char count);
+unsigned char encode_calls(encoder * enc, const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount);
+void encode_put(encoder * enc, const char * pdata, unsigned char len);
+void encode_number(encoder * enc, unsigned long n);
+unsigned char rpc_match(const char * pattern, unsigned char len, unsigned char * pmatch, char c);
+void rpc_body(void * ctx, char c);
+void http_init(http_parser * http, body_handler handler, void * ctx);
+void http_line_end(http_parser * http);
+int http_parse(http_parser * http, const char * p, int len);
+int read_http_response(long socket, body_handler handler, void * ctx);
+int post_alias(char * pbuf, unsigned char bufsize, form_parser * form);
+void buffer_body(void * ctx, char c);
+void form_init(form_parser * form, exosite_value * table, unsigned char count);
+void form_body(void * ctx, char c);
+void request_add(long socket, const void * pdata, long len);
+void request_send(long socket);
+void request_add_aliases(long socket, exosite_value * table, unsigned char count);
 long connect_to_exosite();
+long connect_open(void);
+long connect_done(long sock, long result);
 void sendLine(long socket, unsigned char LINE, const char * payload);
 
 // global functions
 int Exosite_Write(char * pbuf, unsigned char bufsize);
+int Exosite_WriteRead(char * pbuf, unsigned char bufsize, exosite_value * table, unsigned char count);
 int Exosite_Read(char * palias, char * pbuf, unsigned char buflen);
+int Exosite_ReadMulti(exosite_value * table, unsigned char count);
+int Exosite_WriteRecords(const exosite_record * records, unsigned char count);
+int Exosite_WriteRecordsRead(const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount);
+int Exosite_WriteRecordsReadAsync(const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount, exosite_callback done, void * ctx);
+int Exosite_WaitAsync(exosite_value * value, unsigned long timeout, unsigned long since, exosite_callback done, void * ctx);
+int Exosite_Poll(void);
+int Exosite_Timestamp(unsigned long * ptime);
 int Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr, int reset);
 int Exosite_Activate(void);
 void Exosite_SetCIK(char * pCIK);
 int Exosite_GetCIK(char * pCIK);
+void Exosite_ClearCIK(void);
 int Exosite_StatusCode(void);
+void Exosite_Disconnect(void);
+void Exosite_ConnectionStats(unsigned short * preused, unsigned short * pfresh);
 
 // externs
-extern char *itoa(int n, char *s, int b);
-
 // global variables
 static int status_code = 0;
 static int exosite_initialized = 0;
+static long exo_sock = -1;                    // kept-alive connection, -1 if none
+static unsigned char exo_sock_reused = 0;     // last connect_open() reused exo_sock
+static unsigned short connections_reused = 0;
+static unsigned short connections_fresh = 0;
+static unsigned char * request_data;          // data area reserved in the TX buffer
+static long request_room = 0;                 // bytes reserved there, 0 if none
+static long request_used = 0;
+static async_request async;                   // EXO_REQ_IDLE until the first one
+static unsigned char server[META_SERVER_SIZE];  // API server address: IPv4, port
+static unsigned char server_state = SERVER_UNKNOWN;
+static unsigned long server_checked;          // exoHAL_GetMillis() of the last lookup
 
 #ifdef __MSP430F5529__
 #ifdef EN_COM_CONFIG
@@ -111,14 +325,13 @@ static int exosite_initialized = 0;
 #ifndef EN_COM_CONFIG
 	char USER_CIK[CIK_LENGTH + 3] = CIK;
 #endif
-char exosite_provision_info[EXOSITE_LENGTH];
-char strBuf[70];
+char alias_header[ALIAS_HEADER_LENGTH];
+char activate_request[ACTIVATE_HEADER_LENGTH + EXOSITE_LENGTH];
 #elif __IAR_SYSTEMS_ICC__
 #pragma location = "EXO_META"
 __no_init char exo_meta[META_SIZE];
 #endif
-
-unsigned char strLen;
+static unsigned char activate_length = 0;  // used bytes of activate_request
 
 /*****************************************************************************
 *
@@ -127,10 +340,11 @@ unsigned char strLen;
 *  \param  char * vendor, custom's vendor name
 *          char * model, custom's model name
 *
-*  \return string length of assembly customize's vendor information
+*  \return string length of assembly customize's vendor information,
+*          0 if it does not fit
 *
 *  \brief  Initializes the customer's vendor and model name for
-*          provisioning
+*          provisioning and assembles the activation request around them
 *
 *****************************************************************************/
 int
@@ -138,13 +352,13 @@ info_assemble(const char * vendor, const char *model, const char *sn)
 {
   int info_len = 0;
   int assemble_len = 0;
-  char * vendor_info = exosite_provision_info;
+  char * vendor_info = &activate_request[ACTIVATE_HEADER_LENGTH];
 
   // verify the assembly length
   assemble_len = strlen(STR_VENDOR) + strlen(vendor)
                  + strlen(STR_MODEL) + strlen(model)
-                 + strlen(STR_SN) + 3;
-  if (assemble_len > 95)
+                 + strlen(STR_SN) + strlen(sn) + 2;
+  if (assemble_len > EXOSITE_LENGTH)
     return info_len;
 
   // vendor=
@@ -179,7 +393,13 @@ info_assemble(const char * vendor, const char *model, const char *sn)
   memcpy(&vendor_info[info_len], sn, strlen(sn));
   info_len += strlen(sn);
 
-  vendor_info[info_len] = 0;
+  // headers in front of the body
+  memcpy(activate_request,
+         STR_POST_ACTIVATE STR_HOST STR_CONTENT STR_CONTENT_LENGTH STR_LENGTH_END,
+         ACTIVATE_HEADER_LENGTH);
+  set_content_length(&activate_request[LENGTH_DIGITS_OFFSET(ACTIVATE_HEADER_LENGTH)],
+                     info_len);
+  activate_length = ACTIVATE_HEADER_LENGTH + info_len;
 
   return info_len;
 }
@@ -222,6 +442,8 @@ Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr,
   char struuid[EXOSITE_SN_MAXLENGTH];
   unsigned char uuid_len = 0;
 
+  exosite_meta_init(reset);
+
   uuid_len = exoHAL_ReadUUID(if_nbr, (unsigned char *)struuid);
 
   if (0 == uuid_len)
@@ -241,7 +463,14 @@ Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr,
 //  }
 
   // read UUID into 'sn'
-  info_assemble(vendor, model, struuid);
+  if (0 == info_assemble(vendor, model, struuid))
+  {
+    status_code = EXO_STATUS_BAD_MODEL;
+    return 0;
+  }
+
+  load_cik();
+  build_alias_header();
 
   exosite_initialized = 1;
 
@@ -267,117 +496,52 @@ Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr,
 int
 Exosite_Activate(void)
 {
-  int length;
-  char temp[5];
   int newcik = 0;
   int http_status = 0;
-  char cmp_ss[18] = "Content-Length: 40";
-  char *cmp = cmp_ss;
 
   if (!exosite_initialized) {
     status_code = EXO_STATUS_INIT;
     return newcik;
   }
-  //update_m2ip();        //check our IP api to see if the old IP is advertising a new one
-  //exoHAL_Updatm2ip();
-
-  long sock = connect_to_exosite();
-  if (sock < 0) {
-    status_code = EXO_STATUS_BAD_TCP;
-    return 0;
-  }
 
-  // Get activation Serial Number
-  length = strlen(exosite_provision_info);
-  itoa(length, temp, 10); //make a string for length
-  //combine length line in HTTP POST request
-  strLen = strlen(STR_CONTENT_LENGTH);
-  memcpy(strBuf,STR_CONTENT_LENGTH,strLen);
-  memcpy(&strBuf[strLen],temp, strlen(temp));
-  strLen += strlen(temp);
-  memcpy(&strBuf[strLen],STR_CRLF, 2);
-  strLen += 2;
-  memcpy(&strBuf[strLen],STR_CRLF, 2);
-  strLen += 2;
-
-  //Socket send HTTP Request
-  send(sock, STR_POST_ACTIVATE, 35, 0);
-  send(sock, STR_HOST, 22, 0);
-  send(sock, STR_CONTENT, 64, 0);
-  send(sock, strBuf, strLen, 0);
-  send(sock, exosite_provision_info, length, 0);
-
-  http_status = get_http_status(sock);
+  long sock;
+  body_buffer cik;
+  char NCIK[CIK_LENGTH + 3];
 
-  if (200 == http_status)
+  // a kept-alive connection may have been dropped by the server since the
+  // last request - if so, repeat the request once on a fresh connection
+  do
   {
-    unsigned char len;
-    unsigned char cik_len_valid = 0;
-    //unsigned char cik_ctrl = 0;
-    char *p;
-    unsigned char crlf = 0;
-    unsigned char ciklen = 0;
-    char NCIK[CIK_LENGTH + 3];
-
-    do
-    {
-      strLen = exoHAL_SocketRecv(sock, strBuf, RX_SIZE);
-      len = strLen;
-      p = strBuf;
-
-      // Find 4 consecutive \r or \n - should be: \r\n\r\n
-      while (0 < len && 4 > crlf)
-      {
+    sock = connect_to_exosite();
+    if (sock < 0) {
+      return 0;
+    }
 
-   	    if ('\r' == *p || '\n' == *p)
-    	  ++crlf;
-    	else
-    	{
-    	  crlf = 0;
-          if (*cmp == *p)
-          {
-            // check the cik length from http response
-            cmp++;
-            if (cmp > &cmp_ss[17])// + strlen(cmp_ss))
-          	cik_len_valid = 1;
-          }
-          else
-            cmp = cmp_ss;
-    	}
-        ++p;
-        --len;
-      }
+    //Socket send HTTP Request, assembled by Exosite_Init()
+    request_add(sock, activate_request, activate_length);
+    request_send(sock);
 
-      // The body is the cik
-      if (0 < len && 4 == crlf && CIK_LENGTH > ciklen)
-      {
-        // TODO, be more robust - match Content-Length header value to CIK_LENGTH
-        unsigned char need, part;
-        if (!(cik_len_valid == 1)) // cik length != 40
-        {
-          status_code = EXO_STATUS_CONFLICT;
-          exoHAL_SocketClose(sock);
-          return newcik;
-        }
-        need = CIK_LENGTH - ciklen;
-        part = need < len ? need : len;
-        strncpy(NCIK + ciklen, p, part);
-        ciklen += part;
-      }
-    } while (RX_SIZE == strLen);
+    // one byte of room over the CIK, so a longer body doesn't pass as a CIK
+    cik.buf = NCIK;
+    cik.size = CIK_LENGTH + 1;
+    cik.len = 0;
+    http_status = read_http_response(sock, buffer_body, &cik);
+  } while (0 == http_status && exo_sock_reused);
 
-    if (CIK_LENGTH == ciklen)
+  if (200 == http_status)
+  {
+    if (CIK_LENGTH != cik.len) // cik length != 40
     {
-      NCIK[40] = '\r';
-      NCIK[41] = '\n';
-      NCIK[42] = 0;
-      Exosite_SetCIK(NCIK);
-      newcik = 1;
+      status_code = EXO_STATUS_CONFLICT;
+      return newcik;
     }
+    NCIK[40] = '\r';
+    NCIK[41] = '\n';
+    NCIK[42] = 0;
+    Exosite_SetCIK(NCIK);
+    newcik = 1;
   }
 
-  exoHAL_SocketClose(sock);
-
   if (200 == http_status)
   {
     status_code = EXO_STATUS_OK;
@@ -413,11 +577,72 @@ Exosite_SetCIK(char * pCIK)
     return;
   }
   memcpy(USER_CIK, pCIK, CIK_LENGTH+2);
+  exosite_meta_write((unsigned char *)pCIK, CIK_LENGTH, META_CIK);
+  build_alias_header();
   status_code = EXO_STATUS_OK;
   return;
 }
 
 
+/*****************************************************************************
+*
+* build_alias_header
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Assembles the alias request headers around the current CIK
+*
+*****************************************************************************/
+void
+build_alias_header(void)
+{
+  char * p = alias_header;
+
+  memcpy(p, STR_HTTP STR_HOST STR_CIK_HEADER,
+         sizeof(STR_HTTP STR_HOST STR_CIK_HEADER) - 1);
+  p += sizeof(STR_HTTP STR_HOST STR_CIK_HEADER) - 1;
+  memcpy(p, USER_CIK, CIK_LENGTH);
+  p += CIK_LENGTH;
+  memcpy(p, STR_CRLF STR_CONTENT STR_CONTENT_LENGTH STR_LENGTH_END,
+         sizeof(STR_CRLF STR_CONTENT STR_CONTENT_LENGTH STR_LENGTH_END) - 1);
+}
+
+
+/*****************************************************************************
+*
+* set_content_length
+*
+*  \param  pdigits - the LENGTH_DIGITS characters to write, len - the value
+*
+*  \return 1 on success; 0 if len is over LENGTH_MAX, pdigits untouched
+*
+*  \brief  Writes a Content-Length value into a header template, right
+*          aligned and padded with spaces
+*
+*****************************************************************************/
+int
+set_content_length(char * pdigits, unsigned int len)
+{
+  unsigned char i;
+
+  if (len > LENGTH_MAX)
+    return 0;
+
+  for (i = LENGTH_DIGITS; i > 0; i--)
+  {
+    if (0 == len && i < LENGTH_DIGITS)
+      pdigits[i - 1] = ' ';
+    else
+      pdigits[i - 1] = '0' + len % 10;
+    len /= 10;
+  }
+
+  return 1;
+}
+
+
 /*****************************************************************************
 *
 * Exosite_GetCIK
@@ -432,25 +657,96 @@ Exosite_SetCIK(char * pCIK)
 *****************************************************************************/
 int
 Exosite_GetCIK(char * pCIK)
+{
+  if (!cik_valid(USER_CIK))
+  {
+    status_code = EXO_STATUS_BAD_CIK;
+    return 0;
+  }
+
+  if (NULL != pCIK)
+    memcpy(pCIK ,USER_CIK ,CIK_LENGTH + 2);
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_ClearCIK
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Forgets the CIK of the last activation, so a CIK configured by
+*          hand is used from the next Exosite_Init on
+*
+*****************************************************************************/
+void
+Exosite_ClearCIK(void)
+{
+  unsigned char blank[META_CIK_SIZE];
+
+  memset(blank, 0xFF, META_CIK_SIZE);
+  exosite_meta_write(blank, META_CIK_SIZE, META_CIK);
+}
+
+
+/*****************************************************************************
+*
+* cik_valid
+*
+*  \param  pCIK - CIK_LENGTH characters
+*
+*  \return 1 - CIK is lower case hex, 0 - it is not
+*
+*  \brief  Checks the format of a CIK
+*
+*****************************************************************************/
+int
+cik_valid(const char * pCIK)
 {
   unsigned char i;
 
   for (i = 0; i < CIK_LENGTH; i++)
   {
-    if (!(USER_CIK[i] >= 'a' && USER_CIK[i] <= 'f' || USER_CIK[i] >= '0' && USER_CIK[i] <= '9'))
-    {
-      status_code = EXO_STATUS_BAD_CIK;
+    if (!(pCIK[i] >= 'a' && pCIK[i] <= 'f' || pCIK[i] >= '0' && pCIK[i] <= '9'))
       return 0;
-    }
   }
 
-  if (NULL != pCIK)
-    memcpy(pCIK ,USER_CIK ,CIK_LENGTH + 2);
-
   return 1;
 }
 
 
+/*****************************************************************************
+*
+* load_cik
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Takes the CIK kept in meta by the last activation, if any, over
+*          the one configured or built in, so a reboot doesn't activate again
+*
+*****************************************************************************/
+void
+load_cik(void)
+{
+  char meta_cik[META_CIK_SIZE];
+
+  exosite_meta_read((unsigned char *)meta_cik, META_CIK_SIZE, META_CIK);
+  if (!cik_valid(meta_cik))
+    return;
+
+  memcpy(USER_CIK, meta_cik, CIK_LENGTH);
+  USER_CIK[CIK_LENGTH] = '\r';
+  USER_CIK[CIK_LENGTH + 1] = '\n';
+  USER_CIK[CIK_LENGTH + 2] = 0;
+}
+
+
 /*****************************************************************************
 *
 * Exosite_Write
@@ -468,45 +764,124 @@ Exosite_Write(char * pbuf, unsigned char bufsize)
 {
   int success = 0;
   int http_status = 0;
-  char temp[10];
+
+  http_status = post_alias(pbuf, bufsize, NULL);
+
+  if (401 == http_status)
+  {
+    status_code = EXO_STATUS_NOAUTH;
+  }
+  if (204 == http_status)
+  {
+    success = 1;
+    status_code = EXO_STATUS_OK;
+  }
+
+  return success;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_WriteRead
+*
+*  \param  pbuf - string buffer containing data to be sent
+*          bufsize - number of bytes to send
+*          table - aliases to read; each entry's value buffer receives the
+*                  value as a string and len its length
+*          count - number of entries in table
+*
+*  \return number of aliases the server returned a value for
+*
+*  \brief  Writes data to Exosite cloud and reads datasources back in the
+*          same request. The write succeeded if the status code is
+*          EXO_STATUS_OK afterwards.
+*
+*****************************************************************************/
+int
+Exosite_WriteRead(char * pbuf, unsigned char bufsize, exosite_value * table, unsigned char count)
+{
+  int http_status = 0;
+  form_parser form;
+
+  form_init(&form, table, count);
+
+  http_status = post_alias(pbuf, bufsize, &form);
+
+  if (200 == http_status || 204 == http_status)
+  {
+    status_code = EXO_STATUS_OK;
+  }
+  if (401 == http_status)
+  {
+    status_code = EXO_STATUS_NOAUTH;
+  }
+
+  return 200 == http_status ? form.found : 0;
+}
+
+
+/*****************************************************************************
+*
+* post_alias
+*
+*  \param  pbuf - string buffer containing data to be sent
+*          bufsize - number of bytes to send
+*          form - parser holding the aliases to read back, NULL for none
+*
+*  \return http response code, 0 or -1 on failure with status_code set
+*
+*  \brief  Sends an alias write, optionally reading aliases back in the
+*          response, and reads the response
+*
+*****************************************************************************/
+int
+post_alias(char * pbuf, unsigned char bufsize, form_parser * form)
+{
+  int http_status = 0;
 
   if (!exosite_initialized) {
     status_code = EXO_STATUS_INIT;
-    return success;
+    return -1;
   }
 
-  long sock = connect_to_exosite();
-  if (sock < 0) {
-    status_code = EXO_STATUS_BAD_TCP;
-    return 0;
-  }
+  long sock;
 
 // This is an example write POST...
 //  s.send('POST /onep:v1/stack/alias HTTP/1.1\r\n');
 //  s.send('Host: m2.exosite.com\r\n');
 //  s.send('X-Exosite-CIK: fde8756c41427350a072fc119fffab44a13e082d\r\n');
-//  s.send('Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n');
-//  s.send('Content-Length: 6\r\n\r\n');
+//  s.send('Content-Type: application/x-www-form-urlencoded\r\n');
+//  s.send('Content-Length:   6\r\n\r\n');
 //  s.send('temp=2');
+// ...and one that reads temp and humidity back in the response
+//  s.send('POST /onep:v1/stack/alias?temp&humidity HTTP/1.1\r\n');
+
+  set_content_length(&alias_header[LENGTH_DIGITS_OFFSET(ALIAS_HEADER_LENGTH)],
+                     bufsize);
+
+  // a kept-alive connection may have been dropped by the server since the
+  // last request - if so, repeat the request once on a fresh connection
+  do
+  {
+    sock = connect_to_exosite();
+    if (sock < 0) {
+      return -1;
+    }
+
+    // request line, with the aliases to read back as the query string
+    request_add(sock, STR_POST_URL, sizeof(STR_POST_URL) - 1);
+    if (NULL != form && 0 < form->count)
+    {
+      request_add(sock, "?", 1);
+      request_add_aliases(sock, form->table, form->count);
+    }
+    request_add(sock, alias_header, ALIAS_HEADER_LENGTH);
+    request_add(sock, pbuf, bufsize);
+    request_send(sock);
 
-  itoa((int)bufsize, temp, 10); //make a string for length
-  //combine length line in HTTP POST request
-  strLen = strlen(STR_CONTENT_LENGTH);
-  memcpy(strBuf,STR_CONTENT_LENGTH,strLen);
-  memcpy(&strBuf[strLen],temp, strlen(temp));
-  strLen += strlen(temp);
-  memcpy(&strBuf[strLen],STR_CRLF, 2);
-  strLen += 2;
-  memcpy(&strBuf[strLen],STR_CRLF, 2);
-  strLen += 2;
-
-  send(sock, STR_POST_HEADER, 36, 0);
-  send(sock, STR_HOST, 22, 0);
-  send(sock, STR_CIK_HEADER, 15, 0);
-  send(sock, USER_CIK, CIK_LENGTH+2, 0);
-  send(sock, STR_CONTENT, 64, 0);
-  send(sock, strBuf, strLen, 0);
-  send(sock, pbuf, bufsize, 0);
+    http_status = read_http_response(sock, NULL != form ? form_body : NULL, form);
+  } while (0 == http_status && exo_sock_reused);
 
 //  exoHAL_SocketSend(sock, STR_POST_HEADER, 36);
 //  exoHAL_SocketSend(sock, STR_HOST, 22);
@@ -516,21 +891,7 @@ Exosite_Write(char * pbuf, unsigned char bufsize)
 //  exoHAL_SocketSend(sock, strBuf, strLen);
 //  exoHAL_SocketSend(sock, pbuf, bufsize);
 
-  http_status = get_http_status(sock);
-
-  exoHAL_SocketClose(sock);
-
-  if (401 == http_status)
-  {
-    status_code = EXO_STATUS_NOAUTH;
-  }
-  if (204 == http_status)
-  {
-    success = 1;
-    status_code = EXO_STATUS_OK;
-  }
-
-  return success;
+  return http_status;
 }
 
 
@@ -549,222 +910,1734 @@ Exosite_Write(char * pbuf, unsigned char bufsize)
 *****************************************************************************/
 int
 Exosite_Read(char * palias, char * pbuf, unsigned char buflen)
+{
+  exosite_value value;
+
+  value.alias = palias;
+  value.value = pbuf;
+  value.size = buflen;
+  value.len = 0;
+
+  Exosite_ReadMulti(&value, 1);
+
+  return value.len;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_ReadMulti
+*
+*  \param  table - aliases to read; each entry's value buffer receives the
+*                  value as a string and len its length
+*          count - number of entries in table
+*
+*  \return number of aliases the server returned a value for
+*
+*  \brief  Reads several datasources from Exosite cloud in one request
+*
+*****************************************************************************/
+int
+Exosite_ReadMulti(exosite_value * table, unsigned char count)
 {
   int http_status = 0;
-  unsigned char len, vlen;
-  char *p, *pcheck;
-  char temp[10];
+  form_parser form;
+
+  form_init(&form, table, count);
 
   if (!exosite_initialized) {
     status_code = EXO_STATUS_INIT;
     return 0;
   }
 
-  long sock = connect_to_exosite();
-  if (sock < 0) {
-    status_code = EXO_STATUS_BAD_TCP;
-    return 0;
-  }
+  long sock;
 
 // This is an example read GET
-//  s.send('GET /onep:v1/stack/alias?temp HTTP/1.1\r\n')
+//  s.send('GET /onep:v1/stack/alias?temp&humidity HTTP/1.1\r\n')
 //  s.send('Host: m2.exosite.com\r\n')
-//  s.send('X-Exosite-CIK: 5046454a9a1666c3acfae63bc854ec1367167815\r\n')
-//  s.send('Accept: application/x-www-form-urlencoded; charset=utf-8\r\n\r\n')
-
-  itoa((int)buflen, temp, 10); //make a string for length
-
-  strLen = strlen(STR_GET_URL);
-  memcpy(strBuf,STR_GET_URL,strLen);
-  memcpy(&strBuf[strLen],palias, strlen(palias));
-  strLen += strlen(palias);
-  memcpy(&strBuf[strLen],STR_HTTP, strlen(STR_HTTP));
-  strLen += strlen(STR_HTTP);
-
-  strBuf[strLen] = 0;
+//  s.send('X-Exosite-CIK: 5046454a9a1666c3acfae63bc854ec1367167815\r\n\r\n')
 
-  send(sock, strBuf, strLen, 0);
-  send(sock, STR_HOST, 22, 0);
-  send(sock, STR_CIK_HEADER, 15, 0);
-  send(sock, USER_CIK, CIK_LENGTH+2, 0);
-  send(sock, STR_ACCEPT, 60, 0);
+  // a kept-alive connection may have been dropped by the server since the
+  // last request - if so, repeat the request once on a fresh connection
+  do
+  {
+    sock = connect_to_exosite();
+    if (sock < 0) {
+      return 0;
+    }
 
-  pcheck = palias;
-  vlen = 0;
+    request_add(sock, STR_GET_URL, sizeof(STR_GET_URL) - 1);
+    request_add_aliases(sock, table, count);
+    request_add(sock, alias_header, ALIAS_READ_LENGTH);
+    request_add(sock, STR_CRLF, sizeof(STR_CRLF) - 1);
+    request_send(sock);
 
-  http_status = get_http_status(sock);
+    http_status = read_http_response(sock, form_body, &form);
+  } while (0 == http_status && exo_sock_reused);
 
   if (200 == http_status)
   {
-    unsigned char crlf = 0;
+    status_code = EXO_STATUS_OK;
+  }
+  if (204 == http_status)
+  {
+    status_code = EXO_STATUS_OK;
+  }
+  if (401 == http_status)
+  {
+    status_code = EXO_STATUS_NOAUTH;
+  }
 
-    do
-    {
-      strLen = exoHAL_SocketRecv(sock, strBuf, RX_SIZE);
-      len = strLen;
-      p = strBuf;
+  return 200 == http_status ? form.found : 0;
+}
 
-      // Find 4 consecutive \r or \n - should be: \r\n\r\n
-      while (0 < len && 4 > crlf)
+
+/*****************************************************************************
+*
+* Exosite_WriteRecords
+*
+*  \param  records - timestamped values to record
+*          count - number of records
+*
+*  \return 1 success; 0 failure
+*
+*  \brief  Records timestamped values to Exosite cloud in one request,
+*          using the RPC "record" call. Records of the same alias are sent
+*          in one call. The body is encoded straight into the TX buffer,
+*          so the number of records is not limited by a buffer.
+*
+*****************************************************************************/
+int
+Exosite_WriteRecords(const exosite_record * records, unsigned char count)
+{
+  rpc_result result;
+
+  result.table = NULL;
+  result.count = 0;
+
+  return 200 == post_records(records, count, &result);
+}
+
+
+/*****************************************************************************
+*
+* Exosite_WriteRecordsRead
+*
+*  \param  records - timestamped values to record
+*          count - number of records
+*          table - aliases to read; each entry's value buffer receives the
+*                  latest value as a string and len its length
+*          tcount - number of entries in table
+*
+*  \return number of aliases the server returned a value for; -1 if the
+*          records were not written
+*
+*  \brief  Records timestamped values to Exosite cloud and reads
+*          datasources back in the same request
+*
+*****************************************************************************/
+int
+Exosite_WriteRecordsRead(const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount)
+{
+  rpc_result result;
+
+  clear_values(table, tcount);
+  result.table = table;
+  result.count = tcount;
+
+  if (200 != post_records(records, count, &result))
+    return -1;
+
+  return result.found;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_WriteRecordsReadAsync
+*
+*  \param  records, count, table, tcount - as for
+*          Exosite_WriteRecordsRead; all of them have to stay valid until
+*          the request is done, as a dropped kept-alive connection sends
+*          the records again
+*          done - called with what Exosite_WriteRecordsRead would have
+*                 returned once the request is done, NULL for none
+*          ctx - passed to done
+*
+*  \return 1 if the request was started; 0 if another one is in flight,
+*          the library is not initialized or the records don't fit in one
+*          request
+*
+*  \brief  Starts the request of Exosite_WriteRecordsRead without waiting
+*          for it. Exosite_Poll carries it out step by step; no other
+*          request may be made until it is done.
+*
+*****************************************************************************/
+int
+Exosite_WriteRecordsReadAsync(const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount, exosite_callback done, void * ctx)
+{
+  if (!async_start(ASYNC_RECORDS, done, ctx))
+    return 0;
+
+  clear_values(table, tcount);
+  async.records = records;
+  async.count = count;
+  async.result.table = table;
+  async.result.count = tcount;
+  async.patience = ASYNC_RESPONSE_TIMEOUT;
+  if (!records_length(async.length, records, count, &async.result)) {
+    status_code = EXO_STATUS_TOO_LONG;
+    async.state = EXO_REQ_IDLE;
+    return 0;
+  }
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_WaitAsync
+*
+*  \param  value - alias to wait on; its value buffer receives the new value
+*                  as a string and len its length. Has to stay valid until
+*                  the request is done.
+*          timeout - ms the server holds the request at most
+*          since - unix time; a value written after it returns at once. 0
+*                  to wait for the next value written.
+*          done - called with 1 if a value came, 0 if the wait timed out,
+*                 -1 on failure, NULL for none
+*          ctx - passed to done
+*
+*  \return 1 if the request was started; 0 if another one is in flight or
+*          the library is not initialized
+*
+*  \brief  Long-polls a datasource: the server answers as soon as a value
+*          is written to the alias, or with 304 after timeout. Only one
+*          alias can be waited on per request. Carried out by Exosite_Poll
+*          like Exosite_WriteRecordsReadAsync.
+*
+*****************************************************************************/
+int
+Exosite_WaitAsync(exosite_value * value, unsigned long timeout, unsigned long since, exosite_callback done, void * ctx)
+{
+  if (!async_start(ASYNC_WAIT, done, ctx))
+    return 0;
+
+  async.value = value;
+  async.timeout = timeout;
+  async.since = since;
+  async.patience = timeout + ASYNC_RESPONSE_TIMEOUT;
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+* async_start
+*
+*  \param  kind - type of the request, done, ctx - its callback
+*
+*  \return 1 if the request may start; 0 if another one is in flight or
+*          the library is not initialized
+*
+*  \brief  Takes the asynchronous request slot for a new request
+*
+*****************************************************************************/
+int
+async_start(unsigned char kind, exosite_callback done, void * ctx)
+{
+  if (EXO_REQ_IDLE != async.state && EXO_REQ_DONE != async.state)
+    return 0;
+  if (!exosite_initialized) {
+    status_code = EXO_STATUS_INIT;
+    return 0;
+  }
+
+  async.kind = kind;
+  async.done = done;
+  async.ctx = ctx;
+  async.state = EXO_REQ_CONNECTING;
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_Poll
+*
+*  \param  None
+*
+*  \return 1 while an asynchronous request is in flight; 0 when there is
+*          none or it is done
+*
+*  \brief  Takes the asynchronous request one step further. Only the
+*          send waits on the CC3000; the connect is started here and
+*          checked on by later calls, for ASYNC_CONNECT_TIMEOUT at most.
+*          Waiting for the response takes 5 ms at most per call. The
+*          request's callback is called from here.
+*
+*****************************************************************************/
+int
+Exosite_Poll(void)
+{
+  long result;
+
+  switch (async.state)
+  {
+    case EXO_REQ_CONNECTING:
+      async.sock = connect_open();
+      if (async.sock < 0)
+      {
+        async_finish(-1);
+        break;
+      }
+      async.reused = exo_sock_reused;
+      if (!async.reused)
+      {
+        if (exoHAL_ServerConnectStart(async.sock, server) < 0)
+        {
+          connect_done(async.sock, -1);
+          async_finish(-1);
+        }
+        else
+        {
+          async.lastData = exoHAL_GetMillis();
+          async.state = EXO_REQ_CONNECT_WAIT;
+        }
+        break;
+      }
+      exoHAL_SocketSetNonBlocking(async.sock, 1);
+      async.state = EXO_REQ_SENDING;
+      break;
+
+    case EXO_REQ_CONNECT_WAIT:
+      if (!exoHAL_ServerConnectPoll(&result))
+      {
+        if (exoHAL_GetMillis() - async.lastData < ASYNC_CONNECT_TIMEOUT)
+          break;
+        // the server never answered
+        exoHAL_ServerConnectAbandon();
+        result = -1;
+      }
+      async.sock = connect_done(async.sock, result);
+      if (async.sock < 0)
+      {
+        async_finish(-1);
+        break;
+      }
+      exoHAL_SocketSetNonBlocking(async.sock, 1);
+      async.state = EXO_REQ_SENDING;
+      break;
+
+    case EXO_REQ_SENDING:
+      if (ASYNC_WAIT == async.kind)
+      {
+        form_init(&async.form, async.value, 1);
+        send_wait(async.sock, async.value, async.timeout, async.since);
+        http_init(&async.http, form_body, &async.form);
+      }
+      else
+      {
+        async.calls = send_records(async.sock, async.length, async.records, async.count,
+                                   &async.result);
+        http_init(&async.http, rpc_body, &async.result);
+      }
+      async.lastData = exoHAL_GetMillis();
+      async.state = EXO_REQ_AWAITING_STATUS;
+      break;
+
+    case EXO_REQ_AWAITING_STATUS:
+    case EXO_REQ_READING_BODY:
+      async_receive();
+      break;
+  }
+
+  return EXO_REQ_IDLE != async.state && EXO_REQ_DONE != async.state;
+}
+
+
+/*****************************************************************************
+*
+* async_receive
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Reads what has arrived of the response to the asynchronous
+*          request, without waiting for more
+*
+*****************************************************************************/
+void
+async_receive(void)
+{
+  const char * pdata;
+  int len;
+  int ready;
+
+  ready = exoHAL_SocketPoll(async.sock);
+  if (0 == ready)
+  {
+    if (exoHAL_GetMillis() - async.lastData >= async.patience)
+    {
+      // the server went quiet, the connection can't be trusted
+      async.http.keepAlive = 0;
+      async_end();
+    }
+    return;
+  }
+  async.lastData = exoHAL_GetMillis();
+
+  len = 0;
+  if (0 < ready)
+  {
+    // don't read past the end of the body
+    len = RX_SIZE;
+    if ((HTTP_BODY == async.http.state || HTTP_CHUNK_DATA == async.http.state)
+        && async.http.remaining < RX_SIZE)
+      len = (int)async.http.remaining;
+    len = exoHAL_SocketPeek(async.sock, &pdata, (unsigned char)len);
+  }
+  if (0 >= len)
+  {
+    // a body without a length ends when the connection closes
+    if (HTTP_BODY_EOF == async.http.state)
+      async.http.state = HTTP_DONE;
+    else
+      async.http.keepAlive = 0;
+    // a kept-alive connection dropped by the server: once more on a fresh one
+    if (HTTP_STATUS == async.http.state && async.reused)
+    {
+      Exosite_Disconnect();
+      async.state = EXO_REQ_CONNECTING;
+      return;
+    }
+    async_end();
+    return;
+  }
+
+  // parsed where it was received, then given back
+  if (http_parse(&async.http, pdata, len) < len)
+  {
+    // more data than the response, the stream can't be trusted
+    async.http.keepAlive = 0;
+  }
+  exoHAL_SocketRelease(async.sock);
+  if (HTTP_HEADER < async.http.state)
+    async.state = EXO_REQ_READING_BODY;
+  if (HTTP_DONE <= async.http.state)
+    async_end();
+}
+
+
+/*****************************************************************************
+*
+* async_end
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Wraps up the asynchronous request once its response is read or
+*          given up on
+*
+*****************************************************************************/
+void
+async_end(void)
+{
+  int http_status;
+
+  if (HTTP_DONE != async.http.state || !async.http.keepAlive)
+    Exosite_Disconnect();
+  else
+    exoHAL_SocketSetNonBlocking(async.sock, 0);   // blocking again for the other requests
+
+  // a response cut short is a failure whatever its status said
+  http_status = (HTTP_DONE == async.http.state) ? async.http.code : 0;
+  exosite_retry_result(http_status);
+
+  if (ASYNC_WAIT == async.kind)
+  {
+    if (401 == http_status)
+      status_code = EXO_STATUS_NOAUTH;
+    if (200 == http_status || 304 == http_status)
+      status_code = EXO_STATUS_OK;
+    if (304 == http_status)
+      async_finish(0);
+    else
+      async_finish(200 == http_status && 0 < async.form.found ? 1 : -1);
+    return;
+  }
+
+  http_status = records_status(http_status, async.calls, &async.result);
+  async_finish(200 == http_status ? async.result.found : -1);
+}
+
+
+/*****************************************************************************
+*
+* send_wait
+*
+*  \param  sock - connection to send on; value - alias to wait on;
+*          timeout, since - as for Exosite_WaitAsync
+*
+*  \return None
+*
+*  \brief  Sends a long-poll read of one alias
+*
+*****************************************************************************/
+void
+send_wait(long sock, exosite_value * value, unsigned long timeout, unsigned long since)
+{
+  encoder enc;
+
+// This is an example long-poll GET, held up to 30 seconds
+//  s.send('GET /onep:v1/stack/alias?thr_ctrl HTTP/1.1\r\n')
+//  s.send('Host: m2.exosite.com\r\n')
+//  s.send('X-Exosite-CIK: 5046454a9a1666c3acfae63bc854ec1367167815\r\n')
+//  s.send('Request-Timeout: 30000\r\n')
+//  s.send('If-Modified-Since: 1392000000\r\n\r\n')
+
+  request_add(sock, STR_GET_URL, sizeof(STR_GET_URL) - 1);
+  request_add_aliases(sock, value, 1);
+  request_add(sock, alias_header, ALIAS_READ_LENGTH);
+
+  enc.sock = sock;
+  enc.len = 0;
+  encode_put(&enc, STR_REQUEST_TIMEOUT, sizeof(STR_REQUEST_TIMEOUT) - 1);
+  encode_number(&enc, timeout);
+  encode_put(&enc, STR_CRLF, sizeof(STR_CRLF) - 1);
+  if (0 != since)
+  {
+    encode_put(&enc, STR_IF_MODIFIED_SINCE, sizeof(STR_IF_MODIFIED_SINCE) - 1);
+    encode_number(&enc, since);
+    encode_put(&enc, STR_CRLF, sizeof(STR_CRLF) - 1);
+  }
+  encode_put(&enc, STR_CRLF, sizeof(STR_CRLF) - 1);
+  request_send(sock);
+}
+
+
+/*****************************************************************************
+*
+* async_finish
+*
+*  \param  result - what the blocking version of the request returns
+*
+*  \return None
+*
+*  \brief  Marks the asynchronous request done and reports the result
+*
+*****************************************************************************/
+void
+async_finish(int result)
+{
+  async.state = EXO_REQ_DONE;
+  if (NULL != async.done)
+    async.done(result, async.ctx);
+}
+
+
+/*****************************************************************************
+*
+* post_records
+*
+*  \param  records, count - records to write
+*          result - table and count of the aliases to read back, count 0
+*                   for none
+*
+*  \return http response code, 200 only if every call succeeded; 0 or -1
+*          on failure with status_code set
+*
+*  \brief  Sends an RPC request with a "record" call per alias of the
+*          records and a "read" call per alias of the table, and reads
+*          the response
+*
+*****************************************************************************/
+int
+post_records(const exosite_record * records, unsigned char count, rpc_result * result)
+{
+  int http_status = 0;
+  unsigned char calls;
+  char length[sizeof(STR_LENGTH_END)];
+
+  if (!exosite_initialized) {
+    status_code = EXO_STATUS_INIT;
+    return -1;
+  }
+
+  long sock;
+
+// This is an example record POST, two temperatures in one call
+//  s.send('POST /onep:v1/rpc/process HTTP/1.1\r\n')
+//  s.send('Host: m2.exosite.com\r\n')
+//  s.send('Content-Type: application/json; charset=utf-8\r\n')
+//  s.send('Content-Length:  158\r\n\r\n')
+//  s.send('{"auth":{"cik":"5046454a9a1666c3acfae63bc854ec1367167815"},"calls":[')
+//  s.send('{"id":0,"procedure":"record","arguments":[{"alias":"tmpc"},')
+//  s.send('[[1392000000,25],[1392000030,26]],{}]}]}')
+// ...a read call after it returns the latest value of thr_ctrl
+//  s.send('{"id":1,"procedure":"read","arguments":[{"alias":"thr_ctrl"},{"limit":1}]}')
+
+  if (!records_length(length, records, count, result)) {
+    status_code = EXO_STATUS_TOO_LONG;
+    return -1;
+  }
+
+  // a kept-alive connection may have been dropped by the server since the
+  // last request - if so, repeat the request once on a fresh connection
+  do
+  {
+    sock = connect_to_exosite();
+    if (sock < 0) {
+      return -1;
+    }
+
+    calls = send_records(sock, length, records, count, result);
+    http_status = read_http_response(sock, rpc_body, result);
+  } while (0 == http_status && exo_sock_reused);
+
+  return records_status(http_status, calls, result);
+}
+
+
+/*****************************************************************************
+*
+* records_length
+*
+*  \param  length - receives the Content-Length digits and the header end
+*          records, count, result - the request, as for post_records
+*
+*  \return 1 on success; 0 if the body is too long for Content-Length
+*
+*  \brief  Measures the body of a records request without encoding it
+*
+*****************************************************************************/
+int
+records_length(char * length, const exosite_record * records, unsigned char count, rpc_result * result)
+{
+  encoder enc;
+
+  enc.sock = -1;
+  enc.len = 0;
+  encode_calls(&enc, records, count, result->table, result->count);
+  memcpy(length, STR_LENGTH_END, sizeof(STR_LENGTH_END));
+  return set_content_length(length, sizeof(STR_RPC_AUTH STR_RPC_CALLS STR_RPC_END) - 1
+                                    + CIK_LENGTH + enc.len);
+}
+
+
+/*****************************************************************************
+*
+* send_records
+*
+*  \param  sock - connection to send on
+*          length - Content-Length from records_length
+*          records, count, result - as for post_records
+*
+*  \return number of calls in the request
+*
+*  \brief  Sends a records request, the body encoded straight into the
+*          TX buffer, and prepares result for the response
+*
+*****************************************************************************/
+unsigned char
+send_records(long sock, const char * length, const exosite_record * records, unsigned char count, rpc_result * result)
+{
+  unsigned char calls;
+  encoder enc;
+
+  request_add(sock, STR_RPC_HEADER, sizeof(STR_RPC_HEADER) - 1);
+  request_add(sock, length, sizeof(STR_LENGTH_END) - 1);
+  request_add(sock, STR_RPC_AUTH, sizeof(STR_RPC_AUTH) - 1);
+  request_add(sock, USER_CIK, CIK_LENGTH);
+  request_add(sock, STR_RPC_CALLS, sizeof(STR_RPC_CALLS) - 1);
+
+  enc.sock = sock;
+  enc.len = 0;
+  calls = encode_calls(&enc, records, count, result->table, result->count);
+
+  request_add(sock, STR_RPC_END, sizeof(STR_RPC_END) - 1);
+  request_send(sock);
+
+  result->okMatch = 0;
+  result->ok = 0;
+  result->idMatch = 0;
+  result->inId = 0;
+  result->resultMatch = 0;
+  result->valueState = RPC_NO_VALUE;
+  result->firstRead = calls - result->count;
+  result->found = 0;
+  result->entry = NULL;
+
+  return calls;
+}
+
+
+/*****************************************************************************
+*
+* records_status
+*
+*  \param  http_status - response code of a records request, 0 if none
+*          calls - number of calls in the request
+*          result - the parsed response
+*
+*  \return http_status, or 0 if a 200 response did not acknowledge every
+*          call
+*
+*  \brief  Sets status_code from the response to a records request
+*
+*****************************************************************************/
+int
+records_status(int http_status, unsigned char calls, rpc_result * result)
+{
+  if (401 == http_status)
+  {
+    status_code = EXO_STATUS_NOAUTH;
+  }
+  if (200 == http_status)
+  {
+    // every call has to be acknowledged
+    if (calls != result->ok)
+      return 0;
+    status_code = EXO_STATUS_OK;
+  }
+
+  return http_status;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_Timestamp
+*
+*  \param  ptime - receives the server time
+*
+*  \return 1 success; 0 failure
+*
+*  \brief  Reads the current time, in seconds since 1970, from the Exosite
+*          API server
+*
+*****************************************************************************/
+int
+Exosite_Timestamp(unsigned long * ptime)
+{
+  int http_status = 0;
+  long sock;
+  body_buffer body;
+  char digits[11];
+  unsigned char i;
+  unsigned long time = 0;
+
+  do
+  {
+    sock = connect_to_exosite();
+    if (sock < 0) {
+      return 0;
+    }
+
+    request_add(sock, STR_TIMESTAMP, sizeof(STR_TIMESTAMP) - 1);
+    request_send(sock);
+
+    body.buf = digits;
+    body.size = sizeof(digits);
+    body.len = 0;
+    http_status = read_http_response(sock, buffer_body, &body);
+  } while (0 == http_status && exo_sock_reused);
+
+  if (200 != http_status || 0 == body.len || sizeof(digits) == body.len)
+    return 0;
+
+  for (i = 0; i < body.len; i++)
+  {
+    if ('0' > digits[i] || '9' < digits[i])
+      return 0;
+    time = time * 10 + (digits[i] - '0');
+  }
+  *ptime = time;
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+* update_m2ip
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Keeps the API server address current. The address is cached in
+*          meta and looked up again through DNS only once SERVER_TTL has
+*          passed or a connect to it failed. The CC3000 doesn't report the
+*          TTL of the DNS record, so SERVER_TTL stands in for it. A failed
+*          lookup keeps the old address.
+*
+*****************************************************************************/
+void
+update_m2ip(void)
+{
+  unsigned char ip[4];
+  unsigned long now = exoHAL_GetMillis();
+
+  if (SERVER_UNKNOWN == server_state)
+  {
+    // the address stored by an earlier run counts as fresh at boot
+    exosite_meta_read(server, META_SERVER_SIZE, META_SERVER);
+    server_checked = now;
+    server_state = (0xFF == server[0]) ? SERVER_STALE : SERVER_CACHED;
+  }
+  if (SERVER_CACHED == server_state && now - server_checked < SERVER_TTL)
+    return;
+
+  server_state = SERVER_CACHED;
+  if (!exoHAL_ServerLookup(STR_SERVER_NAME, ip))
+  {
+    server_checked = now - SERVER_TTL + SERVER_LOOKUP_RETRY;
+    return;
+  }
+  server_checked = now;
+  if (memcmp(server, ip, sizeof(ip)) || 0 != server[4] || 80 != server[5])
+  {
+    memcpy(server, ip, sizeof(ip));
+    server[4] = 0;                  // port 80
+    server[5] = 80;
+    exosite_meta_write(server, META_SERVER_SIZE, META_SERVER);
+  }
+}
+
+/*****************************************************************************
+*
+* connect_to_exosite
+*
+*  \param  None
+*
+*  \return success: socket handle; failure: -1 with status_code set
+*
+*  \brief  Establishes a connection with Exosite API server. A failed
+*          connect is not repeated here; the retry scheduler holds back
+*          further connects until its backoff has passed.
+*
+*****************************************************************************/
+long
+connect_to_exosite(void)
+{
+  long sock;
+
+  sock = connect_open();
+  if (sock < 0 || exo_sock_reused)
+    return sock;
+
+  return connect_done(sock, exoHAL_ServerConnect(sock, server));
+}
+
+
+/*****************************************************************************
+*
+* connect_open
+*
+*  \param  None
+*
+*  \return the kept-alive connection, exo_sock_reused set; a new socket
+*          still to be connected; failure: -1 with status_code set
+*
+*  \brief  First half of connect_to_exosite: reuses the kept-alive
+*          connection or opens a socket for a new one
+*
+*****************************************************************************/
+long
+connect_open(void)
+{
+  long sock;
+
+  // reuse the kept-alive connection unless the CC3000 has seen it closed
+  if (exo_sock >= 0)
+  {
+    if (SOCKET_STATUS_ACTIVE == get_socket_active_status(exo_sock))
+    {
+      exo_sock_reused = 1;
+      connections_reused++;
+      return exo_sock;
+    }
+    Exosite_Disconnect();
+  }
+  exo_sock_reused = 0;
+
+  if (!exosite_retry_allowed())
+  {
+    status_code = EXO_STATUS_BACKOFF;
+    return -1;
+  }
+
+  update_m2ip();
+
+  sock = exoHAL_SocketOpenTCP(); //ExositeWrite ERROR
+  if (sock < 0)
+    return connect_done(sock, -1);
+
+  return sock;
+}
+
+
+/*****************************************************************************
+*
+* connect_done
+*
+*  \param  sock - socket from connect_open, negative if none
+*          result - what exoHAL_ServerConnect returned for it
+*
+*  \return success: socket handle; failure: -1 with status_code set
+*
+*  \brief  Second half of connect_to_exosite: keeps the connected socket,
+*          or closes it and tells the retry scheduler
+*
+*****************************************************************************/
+long
+connect_done(long sock, long result)
+{
+  if (sock >= 0 && result < 0)
+  {
+    // the server may have moved
+    server_state = SERVER_STALE;
+    // TODO - the typical reason the connect doesn't work is because
+    // something was wrong in the way the comms hardware was initialized (timing, bit
+    // error, etc...). There may be a graceful way to kick the hardware
+    // back into gear at the right state, but for now, we just
+    // return and let the caller retry us if they want
+    exoHAL_SocketClose(sock);
+    sock = -1;
+  }
+  if (sock < 0)
+  {
+    exosite_retry_result(0);
+    status_code = EXO_STATUS_BAD_TCP;
+    return -1;
+  }
+
+  exo_sock = sock;
+  connections_fresh++;
+
+  // Success
+  return sock;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_Disconnect
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Closes the kept-alive connection to the Exosite API server, e.g.
+*          before the radio is shut down. The next request reconnects.
+*
+*****************************************************************************/
+void
+Exosite_Disconnect(void)
+{
+  if (exo_sock >= 0)
+  {
+    exoHAL_SocketClose(exo_sock);
+    exo_sock = -1;
+  }
+}
+
+
+/*****************************************************************************
+*
+* Exosite_ConnectionStats
+*
+*  \param  preused - number of requests sent on a kept-alive connection
+*          pfresh - number of connections opened to the server
+*
+*  \return None
+*
+*  \brief  Reports how often the kept-alive connection saved a reconnect
+*
+*****************************************************************************/
+void
+Exosite_ConnectionStats(unsigned short * preused, unsigned short * pfresh)
+{
+  *preused = connections_reused;
+  *pfresh = connections_fresh;
+}
+
+
+/*****************************************************************************
+*
+* http_init
+*
+*  \param  parser to set up, handler the body is passed to (NULL to drop the
+*          body), context for the handler
+*
+*  \return None
+*
+*  \brief  Prepares an http_parser for a new response
+*
+*****************************************************************************/
+void
+http_init(http_parser * http, body_handler handler, void * ctx)
+{
+  http->state = HTTP_STATUS;
+  http->code = 0;
+  http->col = 0;
+  http->field = 0;
+  http->lengthMatch = 0;
+  http->closeMatch = 0;
+  http->chunkedMatch = 0;
+  http->haveLength = 0;
+  http->keepAlive = 1;
+  http->chunked = 0;
+  http->remaining = 0;
+  http->handler = handler;
+  http->ctx = ctx;
+}
+
+
+/*****************************************************************************
+*
+* http_line_end
+*
+*  \param  parser at the end of a status, header or chunk line
+*
+*  \return None
+*
+*  \brief  Acts on a complete line and moves to the next state
+*
+*****************************************************************************/
+void
+http_line_end(http_parser * http)
+{
+  switch (http->state)
+  {
+    case HTTP_STATUS:
+      if (100 > http->code || 999 < http->code)
+      {
+        http->code = 0;
+        http->state = HTTP_ERROR;
+      }
+      else
+        http->state = HTTP_HEADER;
+      break;
+
+    case HTTP_HEADER:
+      if (0 != http->col)
+      {
+        if (http->closeMatch == sizeof(STR_HDR_CLOSE) - 1)
+          http->keepAlive = 0;
+        if (http->chunkedMatch == sizeof(STR_HDR_CHUNKED) - 1)
+          http->chunked = 1;
+        break;
+      }
+      // empty line, the body follows
+      if (200 > http->code)
+      {
+        // interim 1xx response, the final one follows
+        http_init(http, http->handler, http->ctx);
+      }
+      else if (204 == http->code || 304 == http->code)
+        http->state = HTTP_DONE;
+      else if (http->chunked)
+      {
+        http->remaining = 0;
+        http->state = HTTP_CHUNK_SIZE;
+      }
+      else if (http->haveLength)
+        http->state = (0 == http->remaining) ? HTTP_DONE : HTTP_BODY;
+      else
+      {
+        // no length, the body ends when the server closes the connection
+        http->keepAlive = 0;
+        http->state = HTTP_BODY_EOF;
+      }
+      break;
+
+    case HTTP_CHUNK_SIZE:
+      if (0 == http->col)
+        http->state = HTTP_ERROR;
+      else
+        http->state = (0 == http->remaining) ? HTTP_TRAILER : HTTP_CHUNK_DATA;
+      break;
+
+    case HTTP_CHUNK_END:
+      http->state = HTTP_CHUNK_SIZE;
+      break;
+
+    case HTTP_TRAILER:
+      if (0 == http->col)
+        http->state = HTTP_DONE;
+      break;
+  }
+
+  http->col = 0;
+  http->field = 0;
+  http->lengthMatch = 0;
+  http->closeMatch = 0;
+  http->chunkedMatch = 0;
+}
+
+
+/*****************************************************************************
+*
+* http_parse
+*
+*  \param  parser, received data, number of bytes received
+*
+*  \return number of bytes used, less than len if the response ended
+*          before the data did
+*
+*  \brief  Runs received data through the response parser. The data may be
+*          split anywhere; the parser picks up where the last call stopped.
+*          Body bytes are passed to the parser's body handler.
+*
+*****************************************************************************/
+int
+http_parse(http_parser * http, const char * p, int len)
+{
+  const char * start = p;
+  int n;
+  char c;
+
+  while (0 < len && HTTP_DONE > http->state)
+  {
+    // body data goes to the handler as it is
+    if (HTTP_BODY == http->state || HTTP_BODY_EOF == http->state
+        || HTTP_CHUNK_DATA == http->state)
+    {
+      n = len;
+      if (HTTP_BODY_EOF != http->state)
       {
-        if ('\r' == *p || '\n' == *p)
-        {
-          ++crlf;
-        }
-        else
-        {
-          crlf = 0;
-        }
+        if (http->remaining < (unsigned long)n)
+          n = (int)http->remaining;
+        http->remaining -= n;
+        if (0 == http->remaining)
+          http->state = (HTTP_BODY == http->state) ? HTTP_DONE : HTTP_CHUNK_END;
+      }
+      len -= n;
+      while (0 < n--)
+      {
+        if (NULL != http->handler)
+          http->handler(http->ctx, *p);
         ++p;
-        --len;
       }
+      continue;
+    }
 
-      // The body is "<key>=<value>"
-      if (0 < len && 4 == crlf && buflen > vlen)
-      {
-        // Move past "<key>"
-        while (0 < len && 0 != *pcheck)
+    c = *p++;
+    --len;
+    if ('\n' == c)
+    {
+      http_line_end(http);
+      continue;
+    }
+    if ('\r' == c)
+      continue;
+
+    switch (http->state)
+    {
+      case HTTP_STATUS:
+        // "HTTP/1.1 200 OK" - the code is the second field
+        if (' ' == c)
+          ++http->field;
+        else if (1 == http->field && '0' <= c && '9' >= c && 1000 > http->code)
+          http->code = http->code * 10 + (c - '0');
+        break;
+
+      case HTTP_HEADER:
+        // header names are case insensitive
+        if (http->lengthMatch == http->col
+            && http->lengthMatch < sizeof(STR_HDR_LENGTH) - 1)
         {
-          if (*pcheck == *p)
-          {
-            ++pcheck;
-          }
-          else
-          {
-            pcheck = palias;
-          }
-          ++p;
-          --len;
+          if (STR_HDR_LENGTH[http->lengthMatch] == (c | 0x20))
+            ++http->lengthMatch;
         }
-
-        // Match '=',  we should now have '<key>='
-        if (0 < len && 0 == *pcheck && '=' == *p)
+        else if (http->lengthMatch == sizeof(STR_HDR_LENGTH) - 1
+                 && '0' <= c && '9' >= c)
         {
-          ++p;
-          --len;
+          http->remaining = http->remaining * 10 + (c - '0');
+          http->haveLength = 1;
         }
-
-        // read in the rest of the body as the value
-        while (0 < len && buflen > vlen)
+        if (http->closeMatch == http->col
+            && http->closeMatch < sizeof(STR_HDR_CLOSE) - 1
+            && STR_HDR_CLOSE[http->closeMatch] == (c | 0x20))
+          ++http->closeMatch;
+        if (http->chunkedMatch == http->col
+            && http->chunkedMatch < sizeof(STR_HDR_CHUNKED) - 1
+            && STR_HDR_CHUNKED[http->chunkedMatch] == (c | 0x20))
+          ++http->chunkedMatch;
+        break;
+
+      case HTTP_CHUNK_SIZE:
+        // hex size, chunk extensions after it are ignored
+        if (0 == http->field)
         {
-          pbuf[vlen++] = *p++;
-          --len;
+          if ('0' <= c && '9' >= c)
+            http->remaining = (http->remaining << 4) + (c - '0');
+          else if ('a' <= (c | 0x20) && 'f' >= (c | 0x20))
+            http->remaining = (http->remaining << 4) + ((c | 0x20) - 'a' + 10);
+          else
+            http->field = 1;
         }
+        break;
+
+      case HTTP_CHUNK_END:
+        // only the CRLF may follow the chunk data
+        http->state = HTTP_ERROR;
+        break;
+    }
+
+    if (255 > http->col)
+      ++http->col;
+  }
+
+  return p - start;
+}
+
+
+/*****************************************************************************
+*
+* read_http_response
+*
+*  \param  socket handle, handler the body is passed to (NULL to drop the
+*          body), context for the handler
+*
+*  \return http response code, 0 tcp failure or a response cut short
+*
+*  \brief  Reads a whole response - status, headers and a Content-Length
+*          or chunked body - and stops at its end, so the connection is
+*          ready for the next request. Closes the connection if the server
+*          asks to, the body length is not known or the response is broken.
+*
+*****************************************************************************/
+int
+read_http_response(long socket, body_handler handler, void * ctx)
+{
+  http_parser http;
+  const char * pdata;
+  int len;
+  int code;
+
+  http_init(&http, handler, ctx);
+
+  while (HTTP_DONE > http.state)
+  {
+    // don't read past the end of the body
+    len = RX_SIZE;
+    if ((HTTP_BODY == http.state || HTTP_CHUNK_DATA == http.state)
+        && http.remaining < RX_SIZE)
+      len = (int)http.remaining;
+    len = exoHAL_SocketPeek(socket, &pdata, (unsigned char)len);
+    if (0 >= len)
+    {
+      // a body without a length ends when the connection closes
+      if (HTTP_BODY_EOF == http.state)
+        http.state = HTTP_DONE;
+      else
+        http.keepAlive = 0;
+      break;
+    }
+    // parsed where it was received, then given back
+    if (http_parse(&http, pdata, len) < len)
+    {
+      // more data than the response, the stream can't be trusted
+      http.keepAlive = 0;
+    }
+    exoHAL_SocketRelease(socket);
+  }
+
+  if (HTTP_DONE != http.state || !http.keepAlive)
+    Exosite_Disconnect();
+
+  // a response cut short is a failure whatever its status said
+  code = (HTTP_DONE == http.state) ? http.code : 0;
+  // the server did answer, so repeating the request could apply it twice
+  if (HTTP_STATUS != http.state)
+    exo_sock_reused = 0;
+  // a request on a dropped kept-alive connection is repeated at once, it
+  // isn't a failure yet
+  if (0 != code || !exo_sock_reused)
+    exosite_retry_result(code);
+
+  return code;
+}
+
+
+/*****************************************************************************
+*
+* buffer_body
+*
+*  \param  body_buffer context, next body character
+*
+*  \return None
+*
+*  \brief  Response body handler storing the body into a buffer; whatever
+*          doesn't fit is dropped
+*
+*****************************************************************************/
+void
+buffer_body(void * ctx, char c)
+{
+  body_buffer * body = (body_buffer *)ctx;
+
+  if (body->len < body->size)
+    body->buf[body->len++] = c;
+}
+
+
+/*****************************************************************************
+*
+* clear_values
+*
+*  \param  table of aliases to read, number of entries
+*
+*  \return None
+*
+*  \brief  Empties the values of a table before they are read
+*
+*****************************************************************************/
+void
+clear_values(exosite_value * table, unsigned char count)
+{
+  unsigned char i;
+
+  for (i = 0; i < count; i++)
+  {
+    table[i].len = 0;
+    if (0 < table[i].size)
+      table[i].value[0] = 0;
+  }
+}
+
+
+/*****************************************************************************
+*
+* form_init
+*
+*  \param  parser to set up, table of aliases to read, number of entries
+*
+*  \return None
+*
+*  \brief  Prepares a form_parser for a response and clears the table values
+*
+*****************************************************************************/
+void
+form_init(form_parser * form, exosite_value * table, unsigned char count)
+{
+  clear_values(table, count);
+
+  form->table = table;
+  form->count = count;
+  form->found = 0;
+  form->entry = NULL;
+  form->inValue = 0;
+  form->keyLen = 0;
+  form->hexDigits = 0;
+}
+
+
+/*****************************************************************************
+*
+* form_body
+*
+*  \param  form_parser context, next body character
+*
+*  \return None
+*
+*  \brief  Response body handler for "<alias>=<value>&<alias>=<value>"
+*          bodies. Each value is URL decoded into the table entry of its
+*          alias and kept NUL terminated; values that don't fit are
+*          truncated and aliases not in the table are skipped.
+*
+*****************************************************************************/
+void
+form_body(void * ctx, char c)
+{
+  form_parser * form = (form_parser *)ctx;
+  exosite_value * entry;
+  unsigned char i;
+
+  if (0 < form->hexDigits)
+  {
+    // %XX escape, the decoded character is data even if it is '&' or '='
+    c = (c <= '9') ? c - '0' : (c | 0x20) - 'a' + 10;
+    form->hexValue = (form->hexValue << 4) | (c & 0x0f);
+    if (0 < --form->hexDigits)
+      return;
+    c = form->hexValue;
+  }
+  else if ('%' == c)
+  {
+    form->hexDigits = 2;
+    form->hexValue = 0;
+    return;
+  }
+  else if ('&' == c)
+  {
+    form->entry = NULL;
+    form->inValue = 0;
+    form->keyLen = 0;
+    return;
+  }
+  else if ('=' == c && !form->inValue)
+  {
+    form->inValue = 1;
+    for (i = 0; i < form->count; i++)
+    {
+      entry = &form->table[i];
+      if (form->keyLen == strlen(entry->alias)
+          && 0 == strncmp(form->key, entry->alias, form->keyLen))
+      {
+        form->entry = entry;
+        form->found++;
+        break;
       }
-    } while (RX_SIZE == strLen);
+    }
+    return;
+  }
+  else if ('+' == c)
+  {
+    c = ' ';
   }
 
-  exoHAL_SocketClose(sock);
+  if (!form->inValue)
+  {
+    // an alias too long for the key buffer can't be in the table
+    if (form->keyLen < EXOSITE_ALIAS_MAXLENGTH)
+      form->key[form->keyLen++] = c;
+    else
+      form->keyLen = 0xff;
+    return;
+  }
 
-  if (200 == http_status)
+  entry = form->entry;
+  if (NULL != entry && entry->len + 1 < entry->size)
   {
-    status_code = EXO_STATUS_OK;
+    entry->value[entry->len++] = c;
+    entry->value[entry->len] = 0;
   }
-  if (204 == http_status)
+}
+
+
+/*****************************************************************************
+*
+* encode_calls
+*
+*  \param  enc - where the encoding goes
+*          records, count - records to encode, one "record" call per alias
+*          table, tcount - aliases to encode a "read" call for
+*
+*  \return number of calls encoded
+*
+*  \brief  Encodes the calls of an RPC request
+*
+*****************************************************************************/
+unsigned char
+encode_calls(encoder * enc, const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount)
+{
+  unsigned char i;
+  unsigned char j;
+  unsigned char calls = 0;
+  unsigned char points;
+
+  for (i = 0; i < count; i++)
   {
-    status_code = EXO_STATUS_OK;
+    // the call was made with the first record of the alias
+    for (j = 0; j < i; j++)
+    {
+      if (0 == strcmp(records[j].alias, records[i].alias))
+        break;
+    }
+    if (j < i)
+      continue;
+
+    if (0 != calls)
+      encode_put(enc, ",", 1);
+    encode_put(enc, STR_RPC_ID, sizeof(STR_RPC_ID) - 1);
+    encode_number(enc, calls);
+    encode_put(enc, STR_RECORD_CALL, sizeof(STR_RECORD_CALL) - 1);
+    encode_put(enc, records[i].alias, strlen(records[i].alias));
+    encode_put(enc, STR_RECORD_POINTS, sizeof(STR_RECORD_POINTS) - 1);
+
+    // [timestamp,value] of every record of the alias
+    points = 0;
+    for (j = i; j < count; j++)
+    {
+      if (0 != strcmp(records[j].alias, records[i].alias))
+        continue;
+      if (0 != points++)
+        encode_put(enc, ",", 1);
+      encode_put(enc, "[", 1);
+      encode_number(enc, records[j].timestamp);
+      encode_put(enc, ",", 1);
+      if (0 > records[j].value)
+      {
+        encode_put(enc, "-", 1);
+        encode_number(enc, -(long)records[j].value);
+      }
+      else
+        encode_number(enc, records[j].value);
+      encode_put(enc, "]", 1);
+    }
+
+    encode_put(enc, STR_RECORD_END, sizeof(STR_RECORD_END) - 1);
+    calls++;
   }
-  if (401 == http_status)
+
+  for (i = 0; i < tcount; i++)
   {
-    status_code = EXO_STATUS_NOAUTH;
+    if (0 != calls)
+      encode_put(enc, ",", 1);
+    encode_put(enc, STR_RPC_ID, sizeof(STR_RPC_ID) - 1);
+    encode_number(enc, calls);
+    encode_put(enc, STR_READ_CALL, sizeof(STR_READ_CALL) - 1);
+    encode_put(enc, table[i].alias, strlen(table[i].alias));
+    encode_put(enc, STR_READ_END, sizeof(STR_READ_END) - 1);
+    calls++;
   }
 
-  return vlen;
+  return calls;
 }
 
 
 /*****************************************************************************
 *
-* update_m2ip
+* encode_put
 *
-*  \param  None
+*  \param  enc - where the encoding goes, pdata - data, len - length of data
 *
 *  \return None
 *
-*  \brief  Checks /ip API to see if a new server IP address should be used
+*  \brief  Adds data to an encoding, and to the request unless it is
+*          only measured
 *
 *****************************************************************************/
 void
-update_m2ip(void)
+encode_put(encoder * enc, const char * pdata, unsigned char len)
 {
-  //TODO - stubbed out
-  return;
+  enc->len += len;
+  if (0 <= enc->sock)
+    request_add(enc->sock, pdata, len);
 }
 
+
 /*****************************************************************************
 *
-* connect_to_exosite
+* encode_number
 *
-*  \param  None
+*  \param  enc - where the encoding goes, n - the number
 *
-*  \return success: socket handle; failure: -1;
+*  \return None
 *
-*  \brief  Establishes a connection with Exosite API server
+*  \brief  Adds a number to an encoding as decimal digits
 *
 *****************************************************************************/
-long
-connect_to_exosite(void)
+void
+encode_number(encoder * enc, unsigned long n)
+{
+  char digits[10];
+  unsigned char len = 0;
+
+  do
+  {
+    digits[sizeof(digits) - 1 - len++] = '0' + n % 10;
+    n /= 10;
+  } while (0 != n);
+
+  encode_put(enc, &digits[sizeof(digits) - len], len);
+}
+
+
+/*****************************************************************************
+*
+* rpc_match
+*
+*  \param  pattern, len - text to look for, pmatch - characters matched so
+*          far, c - next character
+*
+*  \return 1 when c completes the pattern
+*
+*  \brief  Looks for a text in a response one character at a time
+*
+*****************************************************************************/
+unsigned char
+rpc_match(const char * pattern, unsigned char len, unsigned char * pmatch, char c)
 {
-  unsigned char connectRetries = 0;
-  long sock = -1;
+  if (pattern[*pmatch] != c)
+    *pmatch = (pattern[0] == c) ? 1 : 0;
+  else if (len == ++*pmatch)
+  {
+    *pmatch = 0;
+    return 1;
+  }
+  return 0;
+}
 
-  while (connectRetries++ <= EXOSITE_MAX_CONNECT_RETRY_COUNT) {
 
-    sock = exoHAL_SocketOpenTCP(); //ExositeWrite ERROR
+/*****************************************************************************
+*
+* rpc_body
+*
+*  \param  rpc_result context, next body character
+*
+*  \return None
+*
+*  \brief  Response body handler for '[{"id":0,"status":"ok"},...]'. Counts
+*          the calls reported as ok and takes the value of each read call
+*          result, '"result":[[<timestamp>,<value>]]', into its table entry
+*          without the quotes of a string value.
+*
+*****************************************************************************/
+void
+rpc_body(void * ctx, char c)
+{
+  rpc_result * result = (rpc_result *)ctx;
+  exosite_value * entry;
+
+  if (RPC_TIMESTAMP == result->valueState)
+  {
+    if (',' == c)
+      result->valueState = RPC_VALUE;
+    return;
+  }
+  if (RPC_VALUE == result->valueState)
+  {
+    entry = result->entry;
+    if (']' == c)
+      result->valueState = RPC_NO_VALUE;
+    else if ('"' != c && NULL != entry && entry->len + 1 < entry->size)
+    {
+      entry->value[entry->len++] = c;
+      entry->value[entry->len] = 0;
+    }
+    return;
+  }
 
-    if (sock == -1)
+  if (result->inId)
+  {
+    if ('0' <= c && '9' >= c)
     {
-      continue;
+      result->id = result->id * 10 + (c - '0');
+      return;
     }
+    result->inId = 0;
+  }
 
-    if (exoHAL_ServerConnect(sock) < 0)  // Try to connect
+  if (rpc_match(STR_RPC_OK, sizeof(STR_RPC_OK) - 1, &result->okMatch, c))
+    result->ok++;
+  if (rpc_match(STR_RPC_RESULT_ID, sizeof(STR_RPC_RESULT_ID) - 1, &result->idMatch, c))
+  {
+    result->inId = 1;
+    result->id = 0;
+  }
+  if (rpc_match(STR_RPC_RESULT, sizeof(STR_RPC_RESULT) - 1, &result->resultMatch, c))
+  {
+    result->entry = NULL;
+    if (result->id >= result->firstRead
+        && result->id - result->firstRead < result->count)
     {
-      // TODO - the typical reason the connect doesn't work is because
-      // something was wrong in the way the comms hardware was initialized (timing, bit
-      // error, etc...). There may be a graceful way to kick the hardware
-      // back into gear at the right state, but for now, we just
-      // return and let the caller retry us if they want
-      continue;
-    } else {
-      connectRetries = 0;
-      break;
+      result->entry = &result->table[result->id - result->firstRead];
+      result->found++;
     }
+    result->valueState = RPC_TIMESTAMP;
   }
+}
 
-  // Success
-  return sock;
+
+/*****************************************************************************
+*
+* request_add
+*
+*  \param  socket handle, data to send, length of data
+*
+*  \return None
+*
+*  \brief  Adds a piece to the request being built. It is copied straight
+*          into the data area reserved in the TX buffer, which goes out as
+*          a packet whenever it fills up, so the request takes as few
+*          packets as possible. If no packet can be reserved the socket has
+*          failed; the piece is dropped and the response read reports it.
+*
+*****************************************************************************/
+void
+request_add(long socket, const void * pdata, long len)
+{
+  long n;
+
+  while (0 < len)
+  {
+    if (request_used == request_room)
+    {
+      request_send(socket);
+      request_room = sl_send_reserve(socket, &request_data, REQUEST_RESERVE);
+      if (0 >= request_room)
+      {
+        request_room = 0;
+        return;
+      }
+    }
+
+    n = request_room - request_used;
+    if (n > len)
+      n = len;
+    memcpy(&request_data[request_used], pdata, n);
+    request_used += n;
+    pdata = (const char *)pdata + n;
+    len -= n;
+  }
 }
 
 
 /*****************************************************************************
 *
-* get_http_status
+* request_send
 *
-*  \param  socket handle, pointer to expected HTTP response code
+*  \param  socket handle
 *
-*  \return http response code, 0 tcp failure
+*  \return None
 *
-*  \brief  Reads first 12 bytes of HTTP response and extracts the 3 byte code
+*  \brief  Sends the part of the request built by request_add() that has
+*          not gone out yet
 *
 *****************************************************************************/
-int
-get_http_status(long socket)
+void
+request_send(long socket)
 {
-  char rxBuf[12];
-  int rxLen = 0;
-  int code = 0;
+  if (0 < request_used)
+    sl_send_commit(socket, request_used);
+  request_room = 0;
+  request_used = 0;
+}
+
 
-  rxLen = exoHAL_SocketRecv(socket, rxBuf, 12);
+/*****************************************************************************
+*
+* request_add_aliases
+*
+*  \param  socket handle, table of aliases, number of entries
+*
+*  \return None
+*
+*  \brief  Adds the aliases of a table to the request as a
+*          "<alias>&<alias>" query string
+*
+*****************************************************************************/
+void
+request_add_aliases(long socket, exosite_value * table, unsigned char count)
+{
+  unsigned char i;
 
-  if (12 == rxLen)
+  for (i = 0; i < count; i++)
   {
-    // example '4','0','4' =>  404  (as number)
-    code = (((rxBuf[9] - 0x30) * 100) +
-            ((rxBuf[10] - 0x30) * 10) +
-            (rxBuf[11] - 0x30));
-    return code;
+    if (0 != i)
+      request_add(socket, "&", 1);
+    request_add(socket, table[i].alias, strlen(table[i].alias));
   }
-  return 0;
 }
 
 
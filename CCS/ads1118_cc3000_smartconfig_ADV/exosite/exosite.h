@@ -63,23 +63,70 @@ enum ExositeStatusCodes
     EXO_STATUS_CONFLICT,
     EXO_STATUS_BAD_CIK,
     EXO_STATUS_NOAUTH,
+    EXO_STATUS_BACKOFF,
+    EXO_STATUS_TOO_LONG,
     EXO_STATUS_END
 };
 
+// steps of an asynchronous request, see Exosite_Poll
+enum ExositeRequestStates
+{
+    EXO_REQ_IDLE,
+    EXO_REQ_CONNECTING,
+    EXO_REQ_CONNECT_WAIT,
+    EXO_REQ_SENDING,
+    EXO_REQ_AWAITING_STATUS,
+    EXO_REQ_READING_BODY,
+    EXO_REQ_DONE
+};
+
 #define EXOSITE_VENDOR_MAXLENGTH                 20
 #define EXOSITE_MODEL_MAXLENGTH                  20
 #define EXOSITE_SN_MAXLENGTH                     EXOSITE_HAL_SN_MAXLENGTH
 #define EXOSITE_DEMO_UPDATE_INTERVAL            4000// ms
 #define CIK_LENGTH                              40
+#define EXOSITE_ALIAS_MAXLENGTH                 24
+
+// one datasource of an Exosite_ReadMulti / Exosite_WriteRead request
+typedef struct
+{
+  const char * alias;       // datasource alias to read
+  char * value;             // receives the value, NUL terminated
+  unsigned char size;       // size of the value buffer
+  unsigned char len;        // length of the value read, 0 if none
+} exosite_value;
+
+// one timestamped value of an Exosite_WriteRecords request
+typedef struct
+{
+  unsigned long timestamp;  // unix time in seconds
+  const char * alias;       // datasource alias to record to
+  int value;
+} exosite_record;
+
+// called from Exosite_Poll when an asynchronous request has finished, with
+// what the blocking version of the request would have returned
+typedef void (*exosite_callback)(int result, void * ctx);
 
 // functions for export
 int Exosite_Write(char * pbuf, unsigned char bufsize);
+int Exosite_WriteRead(char * pbuf, unsigned char bufsize, exosite_value * table, unsigned char count);
 int Exosite_Read(char * palias, char * pbuf, unsigned char buflen);
+int Exosite_ReadMulti(exosite_value * table, unsigned char count);
+int Exosite_WriteRecords(const exosite_record * records, unsigned char count);
+int Exosite_WriteRecordsRead(const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount);
+int Exosite_WriteRecordsReadAsync(const exosite_record * records, unsigned char count, exosite_value * table, unsigned char tcount, exosite_callback done, void * ctx);
+int Exosite_WaitAsync(exosite_value * value, unsigned long timeout, unsigned long since, exosite_callback done, void * ctx);
+int Exosite_Poll(void);
+int Exosite_Timestamp(unsigned long * ptime);
 int Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr, int reset);
 int Exosite_Activate(void);
 void Exosite_SetCIK(char * pCIK);
 int Exosite_GetCIK(char * pCIK);
+void Exosite_ClearCIK(void);
 int Exosite_StatusCode(void);
 int Exosite_GetResponse(void);
+void Exosite_Disconnect(void);
+void Exosite_ConnectionStats(unsigned short * preused, unsigned short * pfresh);
 #endif
 
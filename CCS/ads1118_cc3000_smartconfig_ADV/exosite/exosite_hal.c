@@ -41,11 +41,27 @@
 #include <string.h>
 #include <evnt_handler.h>    // for socketaddr extern
 #include <board.h>
+#include <msp430.h>
 #include <common.h>
+#include "flash.h"
+#include "config_store.h"
+
+// local defines
+#define META_START                0x1C000     // two main flash segments below the sample log,
+#define META_LENGTH               (EXOHAL_META_SEGMENTS * EXOHAL_META_SEGMENT_SIZE) // left out of the linker's memory map
 
 // externs
 extern sockaddr tSocketAddr;
-extern char passMAC[12];
+extern volatile unsigned long uptime;       // seconds, counted by the Timer2 interrupt
+
+// local functions
+static void server_address(const unsigned char * server);
+static void server_connected(long handle, long result, void * ctx);
+
+// local variables
+static volatile unsigned char connect_pending = 0;  // exoHAL_ServerConnectStart in flight
+static volatile unsigned char connect_abandoned = 0; // given up connects still to complete
+static volatile long connect_result;
 
 /*****************************************************************************
 *
@@ -65,7 +81,7 @@ exoHAL_ReadUUID(unsigned char if_nbr, unsigned char * UUID_buf)
 
   #ifdef EN_COM_CONFIG
   	  const char hex[12];
-  	  memcpy((char*)hex, passMAC, 12);
+  	  memcpy((char*)hex, configActive()->mac, 12);
   #endif
   #ifndef EN_COM_CONFIG
   	  const char hex[] = "08002857f2ec";	// HARDCODED - MAC Address
@@ -148,40 +164,188 @@ exoHAL_SocketOpenTCP(void)
 }
 
 
+//*****************************************************************************
+//
+//! exoHAL_ServerLookup
+//!
+//!  \param  name - host name of the server; server - receives its IPv4
+//!          address, first octet first
+//!
+//!  \return 1 if the name was resolved; 0 if not
+//!
+//!  \brief  Resolves the server name through the DNS client of the CC3000
+//
+//*****************************************************************************
+int
+exoHAL_ServerLookup(const char * name, unsigned char * server)
+{
+  unsigned long ip = 0;
+
+  if (0 > gethostbyname((char *)name, strlen(name), &ip) || 0 == ip)
+    return 0;
+
+  server[0] = (unsigned char)(ip >> 24);
+  server[1] = (unsigned char)(ip >> 16);
+  server[2] = (unsigned char)(ip >> 8);
+  server[3] = (unsigned char)ip;
+
+  return 1;
+}
+
+
 //*****************************************************************************
 //
 //! exoHAL_ServerConnect
 //!
-//!  \param  None
+//!  \param  sock - socket handle; server - IPv4 address, first octet
+//!          first, then the port, high byte first
 //!
-//!  \return socket - socket handle
+//!  \return 0 or positive if connected; negative if not
 //!
-//!  \brief  The function opens a TCP socket
+//!  \brief  Connects a TCP socket to the server
 //
 //*****************************************************************************
 long
-exoHAL_ServerConnect(long sock)
+exoHAL_ServerConnect(long sock, const unsigned char * server)
 {
   long retval;
 
-  tSocketAddr.sa_family = 2;
+  server_address(server);
+  retval = connect(sock, &tSocketAddr, sizeof(tSocketAddr));
 
-  //TODO - use DNS or check m2.exosite.com/ip to check for updates
-  tSocketAddr.sa_data[0] = 0;   //server[4];//(port & 0xFF00) >> 8;
-  tSocketAddr.sa_data[1] = 80;  //server[5];//(port & 0x00FF);
-  tSocketAddr.sa_data[2] = 173; //server[0];//173;  // First octet of destination IP
-  tSocketAddr.sa_data[3] = 255; //server[1];//255;  // Second Octet of destination IP
-  tSocketAddr.sa_data[4] = 209; //server[2];//209;  // Third Octet of destination IP
-  tSocketAddr.sa_data[5] =  28; //server[3];//28;   // Fourth Octet of destination IP
+  return retval;
+}
 
-  retval = connect(sock, &tSocketAddr, sizeof(tSocketAddr));
 
-  //if (retval >= 0)
+//*****************************************************************************
+//
+//! exoHAL_ServerConnectStart
+//!
+//!  \param  sock - socket handle; server - as for exoHAL_ServerConnect
+//!
+//!  \return 0 or positive if the connect was started; negative if not
+//!
+//!  \brief  Starts connecting a TCP socket to the server without waiting
+//!          for it; exoHAL_ServerConnectPoll tells when it is done
+//
+//*****************************************************************************
+long
+exoHAL_ServerConnectStart(long sock, const unsigned char * server)
+{
+  long retval;
+
+  server_address(server);
+  connect_pending = 1;
+  retval = connect_async(sock, &tSocketAddr, sizeof(tSocketAddr), server_connected, NULL);
+  if (retval < 0)
+    connect_pending = 0;
 
   return retval;
 }
 
 
+//*****************************************************************************
+//
+//! exoHAL_ServerConnectPoll
+//!
+//!  \param  presult - receives what exoHAL_ServerConnect would have returned
+//!
+//!  \return 1 if the connect started by exoHAL_ServerConnectStart is done;
+//!          0 while it is in flight
+//!
+//!  \brief  Checks on the connect without waiting
+//
+//*****************************************************************************
+int
+exoHAL_ServerConnectPoll(long * presult)
+{
+  if (connect_pending)
+    return 0;
+
+  *presult = connect_result;
+  return 1;
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_ServerConnectAbandon
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Gives up on the connect started by exoHAL_ServerConnectStart.
+//!          The CC3000 still completes it, ahead of any later connect, and
+//!          that completion is dropped.
+//
+//*****************************************************************************
+void
+exoHAL_ServerConnectAbandon(void)
+{
+  unsigned short state = __get_interrupt_state();
+
+  __disable_interrupt();
+  if (connect_pending)
+  {
+    connect_pending = 0;
+    connect_abandoned++;
+  }
+  __set_interrupt_state(state);
+}
+
+
+//*****************************************************************************
+//
+//! server_connected
+//!
+//!  \param  handle - request handle; result - connect() result; ctx - unused
+//!
+//!  \return None
+//!
+//!  \brief  Completion of exoHAL_ServerConnectStart, called from the CC3000
+//!          event handler in interrupt context
+//
+//*****************************************************************************
+static void
+server_connected(long handle, long result, void * ctx)
+{
+  if (connect_abandoned)
+  {
+    // the completion of a connect given up on
+    connect_abandoned--;
+    return;
+  }
+  connect_result = result;
+  connect_pending = 0;
+}
+
+
+//*****************************************************************************
+//
+//! server_address
+//!
+//!  \param  server - as for exoHAL_ServerConnect
+//!
+//!  \return None
+//!
+//!  \brief  Fills tSocketAddr in with the server address
+//
+//*****************************************************************************
+static void
+server_address(const unsigned char * server)
+{
+  tSocketAddr.sa_family = 2;
+
+  tSocketAddr.sa_data[0] = server[4];   // port
+  tSocketAddr.sa_data[1] = server[5];
+  tSocketAddr.sa_data[2] = server[0];   // First octet of destination IP
+  tSocketAddr.sa_data[3] = server[1];   // Second Octet of destination IP
+  tSocketAddr.sa_data[4] = server[2];   // Third Octet of destination IP
+  tSocketAddr.sa_data[5] = server[3];   // Fourth Octet of destination IP
+}
+
+
 //*****************************************************************************
 //
 //! exoHAL_SocketSend
@@ -211,15 +375,224 @@ exoHAL_SocketSend(long socket, char * buffer, unsigned char len)
 //!  \param  socket - socket handle; buffer - string buffer to put info we
 //!          receive; len - size of buffer in bytes;
 //!
-//!  \return Number of bytes received
+//!  \return Number of bytes received, 0 or negative if the connection is
+//!          closed or failed
 //!
-//!  \brief  Sends data out the network interface
+//!  \brief  Receives data from the network interface
 //
 //*****************************************************************************
-unsigned char
+int
 exoHAL_SocketRecv(long socket, char * buffer, unsigned char len)
 {
-  return (unsigned char)recv(socket, buffer, (long)len, 0); //always set flags to 0 for CC3000
+  return (int)recv(socket, buffer, (long)len, 0); //always set flags to 0 for CC3000
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_SocketPeek
+//!
+//!  \param  socket - socket handle; pbuffer - receives where the data is;
+//!          len - most bytes to receive
+//!
+//!  \return Number of bytes received, 0 or negative if the connection is
+//!          closed or failed
+//!
+//!  \brief  Receives data from the network interface and leaves it where
+//!          the interface put it. When something was received it has to be
+//!          given back with exoHAL_SocketRelease before the next call.
+//
+//*****************************************************************************
+int
+exoHAL_SocketPeek(long socket, const char ** pbuffer, unsigned char len)
+{
+  long n = len;
+
+  return recv_peek(socket, (unsigned char **)pbuffer, &n);
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_SocketRelease
+//!
+//!  \param  socket - socket handle
+//!
+//!  \return None
+//!
+//!  \brief  Gives back the data received by exoHAL_SocketPeek
+//
+//*****************************************************************************
+void
+exoHAL_SocketRelease(long socket)
+{
+  recv_release(socket);
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_SocketSetNonBlocking
+//!
+//!  \param  socket - socket handle; on - 1 for receives to return at once,
+//!          0 for receives to wait for data
+//!
+//!  \return None
+//!
+//!  \brief  Sets the receive mode of a socket
+//
+//*****************************************************************************
+void
+exoHAL_SocketSetNonBlocking(long socket, unsigned char on)
+{
+  unsigned long optval = on ? SOCK_ON : SOCK_OFF;
+
+  setsockopt(socket, SOL_SOCKET, SOCKOPT_RECV_NONBLOCK, &optval, sizeof(optval));
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_SocketPoll
+//!
+//!  \param  socket - socket handle
+//!
+//!  \return 1 if data can be received; 0 if none arrived yet; -1 if the
+//!          connection is closed or failed
+//!
+//!  \brief  Checks a socket for received data, waiting no longer than the
+//!          shortest select() timeout of the CC3000 (5 ms)
+//
+//*****************************************************************************
+int
+exoHAL_SocketPoll(long socket)
+{
+  fd_set readsds;
+  fd_set exceptsds;
+  timeval timeout;
+
+  FD_ZERO(&readsds);
+  FD_ZERO(&exceptsds);
+  FD_SET(socket, &readsds);
+  FD_SET(socket, &exceptsds);
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 5000;
+
+  if (0 > select(socket + 1, &readsds, NULL, &exceptsds, &timeout))
+    return -1;
+  // data that came in before a close is still read first
+  if (FD_ISSET(socket, &readsds))
+    return 1;
+  if (FD_ISSET(socket, &exceptsds))
+    return -1;
+
+  return 0;
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_EnableMeta
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Prepares the meta storage; flash needs no setup
+//
+//*****************************************************************************
+void
+exoHAL_EnableMeta(void)
+{
+  return;
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_EraseMeta
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Erases the meta storage to all 0xFF
+//
+//*****************************************************************************
+void
+exoHAL_EraseMeta(void)
+{
+  unsigned char i;
+
+  for (i = 0; i < EXOHAL_META_SEGMENTS; i++)
+    exoHAL_EraseMetaSegment(i);
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_EraseMetaSegment
+//!
+//!  \param  segment - 0 to EXOHAL_META_SEGMENTS - 1
+//!
+//!  \return None
+//!
+//!  \brief  Erases one segment of the meta storage to all 0xFF
+//
+//*****************************************************************************
+void
+exoHAL_EraseMetaSegment(unsigned char segment)
+{
+  if (segment >= EXOHAL_META_SEGMENTS)
+    return;
+  flashEraseSegment(META_START + (unsigned long)segment * EXOHAL_META_SEGMENT_SIZE);
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_WriteMetaItem
+//!
+//!  \param  buffer - data to store; len - size of the data in bytes;
+//!          offset - position in the meta storage
+//!
+//!  \return None
+//!
+//!  \brief  Programs meta bytes, which must be erased; the meta log never
+//!          writes over data
+//
+//*****************************************************************************
+void
+exoHAL_WriteMetaItem(unsigned char * buffer, unsigned char len, int offset)
+{
+  if (offset + len > META_LENGTH)
+    return;
+
+  flashWrite(META_START + offset, buffer, len);
+}
+
+
+//*****************************************************************************
+//
+//! exoHAL_ReadMetaItem
+//!
+//!  \param  buffer - receives the item; len - size of the item in bytes;
+//!          offset - position in the meta storage
+//!
+//!  \return None
+//!
+//!  \brief  Reads a meta item; what lies past the storage reads as 0xFF
+//
+//*****************************************************************************
+void
+exoHAL_ReadMetaItem(unsigned char * buffer, unsigned char len, int offset)
+{
+  if (offset + len > META_LENGTH)
+  {
+    memset(buffer, 0xFF, len);
+    return;
+  }
+  flashRead(META_START + offset, buffer, len);
 }
 
 
@@ -254,6 +627,40 @@ exoHAL_HandleError(unsigned char code)
 
 
 
+//*****************************************************************************
+//
+//! exoHAL_GetMillis
+//!
+//!  \param  None
+//!
+//!  \return milliseconds since boot, wrapping after 49 days
+//!
+//!  \brief  Reads the uptime clock: the seconds counted by the Timer2
+//!          interrupt and the Timer2 count, ACLK/2 = 16384 per second
+//
+//*****************************************************************************
+unsigned long
+exoHAL_GetMillis(void)
+{
+  unsigned long seconds;
+  unsigned int ticks;
+  unsigned short state = __get_interrupt_state();
+
+  __disable_interrupt();
+  ticks = TA2R;
+  seconds = uptime;
+  if (TA2CTL & TAIFG)
+  {
+    // wrapped, the interrupt is still pending
+    ticks = TA2R;
+    seconds++;
+  }
+  __set_interrupt_state(state);
+
+  return seconds * 1000 + (((unsigned long)ticks * 1000) >> 14);
+}
+
+
 //*****************************************************************************
 //
 //! exoHAL_MSDelay
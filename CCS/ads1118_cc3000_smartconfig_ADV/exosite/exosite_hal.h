@@ -38,20 +38,32 @@
 
 // defines
 #define EXOSITE_HAL_SN_MAXLENGTH             16
+#define EXOHAL_META_SEGMENT_SIZE             512     // meta storage erase unit
+#define EXOHAL_META_SEGMENTS                 2
 
 // functions for export
 int exoHAL_ReadUUID(unsigned char if_nbr, unsigned char * UUID_buf);
 void exoHAL_EnableMeta(void);
 void exoHAL_EraseMeta(void);
+void exoHAL_EraseMetaSegment(unsigned char segment);
 void exoHAL_WriteMetaItem(unsigned char * buffer, unsigned char len, int offset);
 void exoHAL_ReadMetaItem(unsigned char * buffer, unsigned char len, int offset);
 void exoHAL_SocketClose(long socket);
 //long exoHAL_SocketOpenTCP(unsigned char *server);
 long exoHAL_SocketOpenTCP(void);
-long exoHAL_ServerConnect(long socket);
+int exoHAL_ServerLookup(const char * name, unsigned char * server);
+long exoHAL_ServerConnect(long socket, const unsigned char * server);
+long exoHAL_ServerConnectStart(long socket, const unsigned char * server);
+int exoHAL_ServerConnectPoll(long * presult);
+void exoHAL_ServerConnectAbandon(void);
 unsigned char exoHAL_SocketSend(long socket, char * buffer, unsigned char len);
-unsigned char exoHAL_SocketRecv(long socket, char * buffer, unsigned char len);
+int exoHAL_SocketRecv(long socket, char * buffer, unsigned char len);
+int exoHAL_SocketPeek(long socket, const char ** pbuffer, unsigned char len);
+void exoHAL_SocketRelease(long socket);
+void exoHAL_SocketSetNonBlocking(long socket, unsigned char on);
+int exoHAL_SocketPoll(long socket);
 void exoHAL_MSDelay(unsigned short delay);
+unsigned long exoHAL_GetMillis(void);
 
 #endif
 
@@ -36,12 +36,42 @@
 #include "exosite_hal.h"
 #include "string.h"
 
+// The meta items are records appended to a log in the active one of two
+// flash segments: element, length, data, and a CRC-16 of those. An item is
+// read from its newest record with a good CRC, so a write cut short by a
+// power loss leaves the previous value in place. A full segment is
+// compacted into the other, whose header is written last: the valid header
+// with the newest sequence number marks the active segment.
+#define META_HEADER_SIZE          4           // magic, sequence number
+#define META_RECORD_HEAD          2           // element, length
+#define META_CRC_SIZE             2
+#define META_RECORD_SIZE(len)     (META_RECORD_HEAD + (len) + META_CRC_SIZE)
+#define META_MAGIC0               'E'
+#define META_MAGIC1               'M'
+#define META_ERASED               0xFF
+#define META_CHUNK                16          // bytes handled at a time on the stack
+
 // external functions
 // externs
 // local functions
+unsigned short meta_crc(unsigned short crc, const unsigned char * pdata, unsigned char len);
+unsigned short meta_flash_crc(int offset, unsigned char len);
+int meta_header(unsigned char segment, unsigned short * pseq);
+int meta_scan(void);
+void meta_format(void);
+void meta_compact(void);
+void meta_append(unsigned char element, const unsigned char * pdata, unsigned char len);
+int meta_matches(int offset, const unsigned char * pdata, unsigned char len);
 // exported functions
 // local defines
 // globals
+static const unsigned char meta_sizes[META_NONE] = {
+  META_CIK_SIZE, META_SERVER_SIZE, META_UUID_SIZE, META_MFR_SIZE
+};
+static int meta_index[META_NONE];             // newest record of each item, 0 if none
+static int meta_tail;                         // where the next record goes
+static unsigned char meta_active;             // segment holding the log
+static unsigned short meta_seq;               // sequence number of meta_active
 
 /*****************************************************************************
 *
@@ -56,13 +86,10 @@
 *****************************************************************************/
 void exosite_meta_init(int reset)
 {
-  char strBuf[META_MARK_SIZE];
-
   exoHAL_EnableMeta();  //turn on the necessary hardware / peripherals
 
-  //check our meta mark - if it isn't there, we wipe the meta structure
-  exosite_meta_read((unsigned char *)strBuf, META_MARK_SIZE, META_MARK);
-  if (strncmp(strBuf, EXOMARK, META_MARK_SIZE) || reset)
+  //index the log - if there isn't one, we start it over
+  if (!meta_scan() || reset)
     exosite_meta_defaults();
 
   return;
@@ -85,9 +112,8 @@ void exosite_meta_defaults(void)
 {
   const unsigned char meta_server_ip[6] = {173,255,209,28,0,80};
 
-  exoHAL_EraseMeta(); //erase the information currently in meta
+  meta_format(); //erase the information currently in meta
   exosite_meta_write((unsigned char *)meta_server_ip, 6, META_SERVER);     //store server IP
-  exosite_meta_write((unsigned char *)EXOMARK, META_MARK_SIZE, META_MARK); //store exosite mark
 
   return;
 }
@@ -103,40 +129,21 @@ void exosite_meta_defaults(void)
 *
 *  \return None
 *
-*  \brief  Writes specific meta information to meta memory
+*  \brief  Writes specific meta information to meta memory. Nothing is
+*          written if the item already holds the data.
 *
 *****************************************************************************/
 void exosite_meta_write(unsigned char * write_buffer, unsigned short srcBytes, unsigned char element)
 {
-  exosite_meta * meta_info = 0;
+  int offset;
 
-  //TODO - do not write if the data already there is identical...
+  if (element >= META_NONE || srcBytes > meta_sizes[element]) return;
 
-  switch (element) {
-    case META_CIK:
-      if (srcBytes > META_CIK_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->cik); //store CIK
-      break;
-    case META_SERVER:
-      if (srcBytes > META_SERVER_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->server); //store server IP
-      break;
-    case META_MARK:
-      if (srcBytes > META_MARK_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->mark); //store exosite mark
-      break;
-    case META_UUID:
-      if (srcBytes > META_UUID_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->uuid); //store UUID
-      break;
-    case META_MFR:
-      if (srcBytes > META_MFR_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->mfr); //store manufacturing info
-      break;
-    case META_NONE:
-    default:
-      break;
-  }
+  offset = meta_index[element];
+  if (0 != offset && meta_matches(offset, write_buffer, srcBytes))
+    return;
+
+  meta_append(element, write_buffer, srcBytes);
 
   return;
 }
@@ -151,40 +158,318 @@ void exosite_meta_write(unsigned char * write_buffer, unsigned short srcBytes, u
 *
 *  \return None
 *
-*  \brief  Writes specific meta information to meta memory
+*  \brief  Reads specific meta information from meta memory. What was never
+*          written reads as erased flash, 0xFF.
 *
 *****************************************************************************/
 void exosite_meta_read(unsigned char * read_buffer, unsigned short destBytes, unsigned char element)
 {
-  exosite_meta * meta_info = 0;
+  unsigned char head[META_RECORD_HEAD];
+  unsigned char size;
+  int offset;
 
-  switch (element) {
-    case META_CIK:
-      if (destBytes < META_CIK_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_CIK_SIZE, (int)meta_info->cik); //read CIK
-      break;
-    case META_SERVER:
-      if (destBytes < META_SERVER_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_SERVER_SIZE, (int)meta_info->server); //read server IP
-      break;
-    case META_MARK:
-      if (destBytes < META_MARK_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_MARK_SIZE, (int)meta_info->mark); //read exosite mark
-      break;
-    case META_UUID:
-      if (destBytes < META_UUID_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_UUID_SIZE, (int)meta_info->uuid); //read provisioning UUID
-      break;
-    case META_MFR:
-      if (destBytes < META_MFR_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_MFR_SIZE, (int)meta_info->mfr); //read manufacturing info
+  if (element >= META_NONE || destBytes < meta_sizes[element]) return;
+
+  size = meta_sizes[element];
+  memset(read_buffer, META_ERASED, size);
+  offset = meta_index[element];
+  if (0 == offset)
+    return;
+
+  exoHAL_ReadMetaItem(head, META_RECORD_HEAD, offset);
+  exoHAL_ReadMetaItem(read_buffer, head[1] < size ? head[1] : size, offset + META_RECORD_HEAD);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  meta_crc
+*
+*  \param  crc - CRC so far, 0xFFFF to start; pdata - bytes to add;
+*          len - number of bytes
+*
+*  \return updated CRC
+*
+*  \brief  CRC-16/CCITT, polynomial 0x1021, a bit at a time
+*
+*****************************************************************************/
+unsigned short meta_crc(unsigned short crc, const unsigned char * pdata, unsigned char len)
+{
+  unsigned char i;
+
+  while (len--)
+  {
+    crc ^= (unsigned short)*pdata++ << 8;
+    for (i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+
+  return crc;
+}
+
+
+/*****************************************************************************
+*
+*  meta_flash_crc
+*
+*  \param  offset - start of the bytes in meta; len - number of bytes
+*
+*  \return CRC of the bytes
+*
+*  \brief  Works out the CRC of bytes in meta memory
+*
+*****************************************************************************/
+unsigned short meta_flash_crc(int offset, unsigned char len)
+{
+  unsigned char chunk[META_CHUNK];
+  unsigned short crc = 0xFFFF;
+  unsigned char n;
+
+  while (len)
+  {
+    n = len < META_CHUNK ? len : META_CHUNK;
+    exoHAL_ReadMetaItem(chunk, n, offset);
+    crc = meta_crc(crc, chunk, n);
+    offset += n;
+    len -= n;
+  }
+
+  return crc;
+}
+
+
+/*****************************************************************************
+*
+*  meta_matches
+*
+*  \param  offset - record in meta; pdata - data to compare; len - its size
+*
+*  \return 1 if the record holds exactly the data, 0 if not
+*
+*  \brief  Compares a record with data about to be written
+*
+*****************************************************************************/
+int meta_matches(int offset, const unsigned char * pdata, unsigned char len)
+{
+  unsigned char chunk[META_CHUNK];
+  unsigned char n;
+
+  exoHAL_ReadMetaItem(chunk, META_RECORD_HEAD, offset);
+  if (chunk[1] != len)
+    return 0;
+
+  offset += META_RECORD_HEAD;
+  while (len)
+  {
+    n = len < META_CHUNK ? len : META_CHUNK;
+    exoHAL_ReadMetaItem(chunk, n, offset);
+    if (memcmp(chunk, pdata, n))
+      return 0;
+    pdata += n;
+    offset += n;
+    len -= n;
+  }
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+*  meta_header
+*
+*  \param  segment - 0 or 1; pseq - receives the sequence number
+*
+*  \return 1 if the segment has a valid header, 0 if not
+*
+*  \brief  Reads the header of a meta segment
+*
+*****************************************************************************/
+int meta_header(unsigned char segment, unsigned short * pseq)
+{
+  unsigned char header[META_HEADER_SIZE];
+
+  exoHAL_ReadMetaItem(header, META_HEADER_SIZE, segment * EXOHAL_META_SEGMENT_SIZE);
+  if (META_MAGIC0 != header[0] || META_MAGIC1 != header[1])
+    return 0;
+  *pseq = header[2] | (unsigned short)header[3] << 8;
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+*  meta_scan
+*
+*  \param  None
+*
+*  \return 1 if a log was found, 0 if not
+*
+*  \brief  Finds the active segment and indexes the newest good record of
+*          each item. A record cut short leaves the rest of the segment
+*          unused; the next write compacts the log.
+*
+*****************************************************************************/
+int meta_scan(void)
+{
+  unsigned char head[META_RECORD_HEAD];
+  unsigned char crc[META_CRC_SIZE];
+  unsigned short seq0, seq1;
+  int valid0, valid1;
+  int offset, end;
+
+  valid0 = meta_header(0, &seq0);
+  valid1 = meta_header(1, &seq1);
+  if (!valid0 && !valid1)
+    return 0;
+  // the newer of two, across a wrap of the sequence number
+  meta_active = !valid0 || (valid1 && (short)(seq1 - seq0) > 0);
+  meta_seq = meta_active ? seq1 : seq0;
+
+  memset(meta_index, 0, sizeof(meta_index));
+  offset = meta_active * EXOHAL_META_SEGMENT_SIZE + META_HEADER_SIZE;
+  end = (meta_active + 1) * EXOHAL_META_SEGMENT_SIZE;
+  while (offset + META_RECORD_HEAD <= end)
+  {
+    exoHAL_ReadMetaItem(head, META_RECORD_HEAD, offset);
+    if (META_ERASED == head[0])
       break;
-    case META_NONE:
-    default:
+    if (META_ERASED == head[1] || offset + META_RECORD_SIZE(head[1]) > end)
+    {
+      offset = end;
       break;
+    }
+    exoHAL_ReadMetaItem(crc, META_CRC_SIZE, offset + META_RECORD_HEAD + head[1]);
+    if (head[0] < META_NONE && head[1] <= meta_sizes[head[0]]
+        && meta_flash_crc(offset, META_RECORD_HEAD + head[1]) == (crc[0] | (unsigned short)crc[1] << 8))
+    {
+      meta_index[head[0]] = offset;
+    }
+    offset += META_RECORD_SIZE(head[1]);
   }
+  meta_tail = offset;
 
-  return;
+  return 1;
 }
 
 
+/*****************************************************************************
+*
+*  meta_format
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Erases the meta memory and starts an empty log
+*
+*****************************************************************************/
+void meta_format(void)
+{
+  unsigned char header[META_HEADER_SIZE] = {META_MAGIC0, META_MAGIC1, 0, 0};
+
+  exoHAL_EraseMeta();
+  exoHAL_WriteMetaItem(header, META_HEADER_SIZE, 0);
+  memset(meta_index, 0, sizeof(meta_index));
+  meta_active = 0;
+  meta_seq = 0;
+  meta_tail = META_HEADER_SIZE;
+}
+
+
+/*****************************************************************************
+*
+*  meta_compact
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Copies the newest record of each item to the other segment and
+*          makes it the active one
+*
+*****************************************************************************/
+void meta_compact(void)
+{
+  unsigned char chunk[META_CHUNK];
+  unsigned char header[META_HEADER_SIZE];
+  int index[META_NONE];
+  unsigned char target = !meta_active;
+  unsigned char element;
+  unsigned char n;
+  int from, to, left;
+
+  exoHAL_EraseMetaSegment(target);
+  to = target * EXOHAL_META_SEGMENT_SIZE + META_HEADER_SIZE;
+  for (element = 0; element < META_NONE; element++)
+  {
+    index[element] = 0;
+    from = meta_index[element];
+    if (0 == from)
+      continue;
+    index[element] = to;
+    exoHAL_ReadMetaItem(chunk, META_RECORD_HEAD, from);
+    for (left = META_RECORD_SIZE(chunk[1]); left; left -= n)
+    {
+      n = left < META_CHUNK ? left : META_CHUNK;
+      exoHAL_ReadMetaItem(chunk, n, from);
+      exoHAL_WriteMetaItem(chunk, n, to);
+      from += n;
+      to += n;
+    }
+  }
+
+  // the copy counts once its header is there
+  meta_seq++;
+  header[0] = META_MAGIC0;
+  header[1] = META_MAGIC1;
+  header[2] = meta_seq & 0xFF;
+  header[3] = meta_seq >> 8;
+  exoHAL_WriteMetaItem(header, META_HEADER_SIZE, target * EXOHAL_META_SEGMENT_SIZE);
+
+  memcpy(meta_index, index, sizeof(meta_index));
+  meta_active = target;
+  meta_tail = to;
+}
+
+
+/*****************************************************************************
+*
+*  meta_append
+*
+*  \param  element - item from MetaElements enum; pdata - its data;
+*          len - size of the data
+*
+*  \return None
+*
+*  \brief  Appends a record to the log, compacting it first if the active
+*          segment is full
+*
+*****************************************************************************/
+void meta_append(unsigned char element, const unsigned char * pdata, unsigned char len)
+{
+  unsigned char head[META_RECORD_HEAD];
+  unsigned char crc[META_CRC_SIZE];
+  unsigned short value;
+  int offset;
+
+  if (meta_tail + META_RECORD_SIZE(len) > (meta_active + 1) * EXOHAL_META_SEGMENT_SIZE)
+    meta_compact();
+
+  head[0] = element;
+  head[1] = len;
+  value = meta_crc(meta_crc(0xFFFF, head, META_RECORD_HEAD), pdata, len);
+  crc[0] = value & 0xFF;
+  crc[1] = value >> 8;
+
+  offset = meta_tail;
+  exoHAL_WriteMetaItem(head, META_RECORD_HEAD, offset);
+  exoHAL_WriteMetaItem((unsigned char *)pdata, len, offset + META_RECORD_HEAD);
+  exoHAL_WriteMetaItem(crc, META_CRC_SIZE, offset + META_RECORD_HEAD + len);
+
+  meta_index[element] = offset;
+  meta_tail = offset + META_RECORD_SIZE(len);
+}
@@ -0,0 +1,220 @@
+/*****************************************************************************
+*
+*  exosite_retry.c - Exosite request retry scheduler.
+*  Copyright (C) 2014 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the   
+*    distribution.
+*
+*    Neither the name of Texas Instruments Incorporated nor the names of
+*    its contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*
+*****************************************************************************/
+#include "exosite_retry.h"
+#include "exosite_hal.h"
+
+// local defines
+#define RANDOM_BITS               16          // of retry_random()
+
+// backoff of one failure class: the first free failures in a row retry at
+// once, the ones after wait base ms doubling up to cap ms
+typedef struct
+{
+  unsigned long base;
+  unsigned long cap;
+  unsigned char free;
+} retry_policy;
+
+// local functions
+unsigned short retry_random(void);
+// globals
+static const retry_policy policies[EXO_RETRY_END] = {
+  {1000UL, 300000UL, 0},      // EXO_RETRY_TCP: link or server down
+  {5000UL, 600000UL, 1},      // EXO_RETRY_NOAUTH: the first 401 goes to reactivation at once
+  {30000UL, 1800000UL, 0}     // EXO_RETRY_CONFLICT: waits for the device to be re-enabled
+};
+static exosite_retry_stats retry;
+static unsigned long since;             // exoHAL_GetMillis() the backoff started
+static unsigned short seed = 0;
+
+/*****************************************************************************
+*
+*  exosite_retry_allowed
+*
+*  \param  None
+*
+*  \return 1 if a connection may be attempted now; 0 during a backoff
+*
+*  \brief  Asked before every connect to the Exosite API server
+*
+*****************************************************************************/
+int
+exosite_retry_allowed(void)
+{
+  if (0 != exosite_retry_wait())
+  {
+    retry.deferred++;
+    return 0;
+  }
+
+  retry.attempts++;
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+*  exosite_retry_result
+*
+*  \param  http_status - response code of a request, 0 or -1 if the
+*          connection or the response failed
+*
+*  \return None
+*
+*  \brief  Records how a request went. A 2xx or 304 response ends any
+*          backoff; a failure starts the backoff of its class, doubling with
+*          each failure of the class in a row. Half the delay is random, so
+*          devices that lost the server together don't come back together.
+*
+*****************************************************************************/
+void
+exosite_retry_result(int http_status)
+{
+  const retry_policy * policy;
+  unsigned char failureClass;
+  unsigned char shift;
+  unsigned long delay;
+  unsigned long half;
+  unsigned short r;
+
+  if (200 <= http_status && 300 > http_status || 304 == http_status)
+  {
+    for (failureClass = 0; failureClass < EXO_RETRY_END; failureClass++)
+      retry.failures[failureClass] = 0;
+    retry.delay = 0;
+    return;
+  }
+
+  if (401 == http_status || 403 == http_status)
+    failureClass = EXO_RETRY_NOAUTH;
+  else if (404 == http_status || 409 == http_status)
+    failureClass = EXO_RETRY_CONFLICT;
+  else
+    failureClass = EXO_RETRY_TCP;
+
+  policy = &policies[failureClass];
+  if (255 > retry.failures[failureClass])
+    retry.failures[failureClass]++;
+  if (retry.failures[failureClass] <= policy->free)
+  {
+    retry.delay = 0;
+    return;
+  }
+
+  delay = policy->base;
+  shift = retry.failures[failureClass] - policy->free - 1;
+  while (0 < shift-- && delay < policy->cap)
+    delay <<= 1;
+  if (delay > policy->cap)
+    delay = policy->cap;
+
+  // equal jitter: half fixed, half random
+  half = delay >> 1;
+  r = retry_random();
+  retry.delay = delay - half + (half >> RANDOM_BITS) * r
+                + (((half & 0xFFFF) * r) >> RANDOM_BITS);
+  since = exoHAL_GetMillis();
+}
+
+
+/*****************************************************************************
+*
+*  exosite_retry_wait
+*
+*  \param  None
+*
+*  \return ms until the next connection may be attempted, 0 if now
+*
+*  \brief  Time left of the current backoff
+*
+*****************************************************************************/
+unsigned long
+exosite_retry_wait(void)
+{
+  unsigned long elapsed;
+
+  if (0 == retry.delay)
+    return 0;
+
+  elapsed = exoHAL_GetMillis() - since;
+  if (elapsed >= retry.delay)
+    return 0;
+
+  return retry.delay - elapsed;
+}
+
+
+/*****************************************************************************
+*
+*  exosite_retry_read
+*
+*  \param  stats - receives the current backoff and the counters
+*
+*  \return None
+*
+*  \brief  Makes the retry timing observable
+*
+*****************************************************************************/
+void
+exosite_retry_read(exosite_retry_stats * stats)
+{
+  *stats = retry;
+  stats->wait = exosite_retry_wait();
+}
+
+
+/*****************************************************************************
+*
+*  retry_random
+*
+*  \param  None
+*
+*  \return pseudo random number
+*
+*  \brief  16 bit xorshift, seeded from the clock on first use
+*
+*****************************************************************************/
+unsigned short
+retry_random(void)
+{
+  if (0 == seed)
+    seed = (unsigned short)exoHAL_GetMillis() | 1;
+  seed ^= seed << 7;
+  seed ^= seed >> 9;
+  seed ^= seed << 8;
+
+  return seed;
+}
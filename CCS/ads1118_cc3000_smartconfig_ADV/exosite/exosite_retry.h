@@ -0,0 +1,64 @@
+/*****************************************************************************
+*
+*  exosite_retry.h - Exosite request retry scheduler header
+*  Copyright (C) 2014 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the   
+*    distribution.
+*
+*    Neither the name of Texas Instruments Incorporated nor the names of
+*    its contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*
+*****************************************************************************/
+
+#ifndef EXOSITE_RETRY_H
+#define EXOSITE_RETRY_H
+
+// defines
+enum ExositeRetryClasses
+{
+    EXO_RETRY_TCP,            // no connection or no usable response
+    EXO_RETRY_NOAUTH,         // CIK rejected
+    EXO_RETRY_CONFLICT,       // activation refused
+    EXO_RETRY_END
+};
+
+typedef struct
+{
+    unsigned long delay;                        // ms of the current backoff, 0 if none
+    unsigned long wait;                         // ms left of it
+    unsigned short attempts;                    // connects tried
+    unsigned short deferred;                    // connects held back by a backoff
+    unsigned char failures[EXO_RETRY_END];      // in a row, by class
+} exosite_retry_stats;
+
+// functions for export
+int exosite_retry_allowed(void);
+void exosite_retry_result(int http_status);
+unsigned long exosite_retry_wait(void);
+void exosite_retry_read(exosite_retry_stats * stats);
+
+#endif
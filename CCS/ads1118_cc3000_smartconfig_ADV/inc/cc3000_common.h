@@ -157,6 +157,10 @@ extern "C" {
 
 #endif  
 
+// Number of RX buffers: while the host processes one received packet the SPI
+// can already read the next into another. Each costs CC3000_RX_BUFFER_SIZE.
+#define CC3000_RX_SLOTS         (2)
+
 //*****************************************************************************
 //                  Compound Types
 //*****************************************************************************
@@ -259,6 +263,39 @@ extern void SimpleLinkWaitEvent(unsigned short usOpcode, void *pRetParams);
 
 extern void SimpleLinkWaitData(unsigned char *pBuf, unsigned char *from, unsigned char *fromlen);
 
+//*****************************************************************************
+//
+//!  SimpleLinkBorrowData
+//!
+//!  @param  pData      receives where the data starts
+//!
+//!  @return               none
+//!
+//!  @brief                Wait for data like SimpleLinkWaitData, but leave it
+//!                        in the SPI RX buffer instead of copying it out. The
+//!                        buffer stays with the caller until
+//!                        SimpleLinkReturnData; no other command may be
+//!                        waited on meanwhile.
+//
+//*****************************************************************************
+
+extern void SimpleLinkBorrowData(unsigned char **pData);
+
+//*****************************************************************************
+//
+//!  SimpleLinkReturnData
+//!
+//!  @param  none
+//!
+//!  @return               none
+//!
+//!  @brief                Gives back the SPI RX buffer taken by
+//!                        SimpleLinkBorrowData
+//
+//*****************************************************************************
+
+extern void SimpleLinkReturnData(void);
+
 //*****************************************************************************
 //
 //!  UINT32_TO_STREAM_f
@@ -10,23 +10,26 @@
 
 #include "cc3000_common.h"
 #include "socket.h"
+#include "config_store.h"
 
 // local defines
 #define ExositeAppVersion                  "  v0.1  "
 #define WRITE_INTERVAL 0
-#define EXO_BUFFER_SIZE 200		//reserve 200 bytes for packing all our write data into a buffer
-#ifdef __MSP430F5529__
-char exo_buffer[EXO_BUFFER_SIZE];
-#elif __IAR_SYSTEMS_ICC__
-#pragma location = "EXO_DATA"
-__no_init char exo_buffer[EXO_BUFFER_SIZE];
-#endif
+#define ASSOC_TIMEOUT 60		//seconds to wait for an access point before logging the readings
+#define RETRY_WAIT_MAX 30000	//ms at most waited out of an Exosite retry backoff
 
 // functions
 unsigned char checkWiFiConnected(void);
 void show_status(void);
+int retryWait(void);
+void applyControls(void);
+void logSample(void);
+unsigned char recordSample(void);
+unsigned char publishDue(unsigned char sensor, unsigned long now);
+void windowWritten(int found, void * ctx);
+int waitSetpoint(void);
+void setpointWritten(int result, void * ctx);
 void initNetworkConfig(void);
-void initNetworkInitRead(char passPASS[], int flashAddr, int sizePASS);
 
 // externs
 extern const char sensorNames[10][11];
@@ -37,7 +40,7 @@ extern void sendByte(char b);
 // global variables
 char configChoice;
 char serverErrorCode = 0;
-int cloud_status = -1;
+int cloud_status = -1;                                                     //0 while the device holds a working CIK
 int configFlag = 0;
 int expireCount = 0;														//increments every 500ms
 long serverSocket;
@@ -52,19 +55,6 @@ volatile char runSmartConfig = 0; 											// brief Flag indicating whether us
 sockaddr serverSocketAddr;
 #ifdef EN_COM_CONFIG
 	char DevServname[16];
-	extern char passSSID[32];
-	extern char passPASS[32];
-	extern char passSECU[1];
-	extern char passMAC[12];
-	extern char passDEVNAME[32];
-	extern char passMODNAME[32];
-	extern int PTRpassSSID;
-	extern int PTRpassPASS;
-	extern int PTRpassSECU;
-	extern int PTRpassMAC;
-	extern int PTRpassCIK;
-	extern int PTRpassDEVNAME;
-	extern int PTRpassMODNAME;
 #endif
 #ifndef EN_COM_CONFIG
 	char DevServname[] = {'C','C','3','0','0','0'};	//Device name - used for Smart config in order to stop the Smart phone configuration process // HARDCODED - Device Name
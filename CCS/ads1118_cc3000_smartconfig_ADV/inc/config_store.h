@@ -0,0 +1,68 @@
+/*****************************************************************************
+*
+*  config_store.h - Network and Exosite configuration store function headers
+*  Copyright (C) 2014 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Texas Instruments Incorporated nor the names of
+*    its contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+// Copies A and B of the configuration, each in its own segment at the start
+// of FLASH, left out of the linker's memory map. Below 64K so the copy in use
+// can be read through a plain pointer.
+#define CONFIG_START                            0x4400
+#define CONFIG_VERSION                          1
+
+// The configuration entered over the COM port. Strings are null terminated
+// and empty when not set.
+typedef struct
+{
+  unsigned char version;        // CONFIG_VERSION
+  unsigned char pad;
+  unsigned int sequence;        // the valid copy counting higher is current
+  char ssid[33];
+  char pass[33];
+  char secu[2];                 // '0' unsecured to '3' WPA2
+  char mac[13];                 // 12 hex digits
+  char cik[41];
+  char devname[17];
+  char modname[33];
+  unsigned int crc;             // CRC-16 of the bytes before it
+} network_config;
+
+// local functions for export
+void configInit(void);
+const network_config * configActive(void);
+network_config * configDraft(void);
+int configCommit(void);
+
+#endif
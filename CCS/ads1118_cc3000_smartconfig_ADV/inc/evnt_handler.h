@@ -132,6 +132,77 @@ typedef struct _bsd_read_return_t
 #define BSD_RECV_FROM_FROMLEN_OFFSET	(4)
 #define BSD_RECV_FROM_FROM_OFFSET		(16)
 
+// Number of asynchronous socket requests that can be in flight at once
+#define SOCKET_ASYNC_REQUESTS			(4)
+
+// An asynchronous socket request, completed by hci_async_event_handler
+typedef struct _socket_async_request_t
+{
+    long             lHandle;               // 0 while the slot is free
+    unsigned short   usOpcode;              // event that completes it
+    long             lSd;
+    unsigned char    ucAwaitData;           // recv: event seen, data next
+    long             lResult;
+    long             lLen;                  // recv: size of pOut[0]
+    void            *pOut[3];               // where the results go
+    tSocketAsyncCB   pfCallback;
+    void            *pCtx;
+} tSocketAsyncRequest;
+
+//*****************************************************************************
+//
+//!  hci_async_request
+//!
+//!  @param  usOpcode    event that completes the request
+//!  @param  lSd         socket of the request
+//!  @param  pfCallback  called with the handle and the result on completion
+//!  @param  pCtx        passed to pfCallback
+//!
+//!  @return             the request, its lHandle set; NULL if all
+//!                      SOCKET_ASYNC_REQUESTS are in flight
+//!
+//!  @brief              Takes a slot for an asynchronous socket request. It
+//!                      has to be taken before the command is sent, since
+//!                      the event may come at any time after.
+//
+//*****************************************************************************
+extern tSocketAsyncRequest *hci_async_request(unsigned short usOpcode, long lSd,
+                                              tSocketAsyncCB pfCallback, void *pCtx);
+
+//*****************************************************************************
+//
+//!  hci_async_cancel
+//!
+//!  @param  pRequest    request from hci_async_request
+//!
+//!  @return             none
+//!
+//!  @brief              Frees the slot of a request whose command could not
+//!                      be sent
+//
+//*****************************************************************************
+extern void hci_async_cancel(tSocketAsyncRequest *pRequest);
+
+//*****************************************************************************
+//
+//!  hci_async_event_handler
+//!
+//!  @param  pucReceivedData  received event or data packet
+//!
+//!  @return             1 if the packet completed (or continued) an
+//!                      asynchronous request, 0 if it belongs to no request
+//!
+//!  @brief              Matches a packet to an asynchronous request by its
+//!                      opcode, and by its socket for the events that name
+//!                      one; otherwise the oldest request for the opcode
+//!                      gets it, as the CC3000 answers in order. The results
+//!                      are stored and the callback called, from the event
+//!                      handler and so mostly from the SPI interrupt;
+//!                      always with interrupts disabled.
+//
+//*****************************************************************************
+extern long hci_async_event_handler(unsigned char *pucReceivedData);
+
 
 typedef struct _bsd_select_return_t
 {
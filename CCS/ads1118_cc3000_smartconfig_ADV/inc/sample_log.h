@@ -0,0 +1,57 @@
+/*****************************************************************************
+*
+*  sample_log.h - Store-and-forward sample log function headers
+*  Copyright (C) 2014 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Texas Instruments Incorporated nor the names of
+*    its contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+// The log takes the top 32K of FLASH2, left out of the linker's memory map
+#define LOG_START                               0x1C400
+#define LOG_SEGMENTS                            64
+#define LOG_RECORD_SIZE                         8
+#define LOG_SEGMENT_SLOTS                       (FLASH_SEGMENT_SIZE / LOG_RECORD_SIZE)
+#define LOG_SLOTS                               (LOG_SEGMENTS * LOG_SEGMENT_SLOTS)
+#define LOG_RESYNC_INTERVAL                     3600    // seconds the uptime clock is trusted
+
+// local functions for export
+void logInit(void);
+void logAppend(unsigned char sensor, int value, unsigned long sampleUptime);
+unsigned int logPending(void);
+unsigned long logUptime(void);
+int logSyncClock(void);
+int logClockValid(void);
+unsigned long logUnixTime(unsigned long sampleUptime);
+int logUpload(exosite_record * records, unsigned char size);
+
+#endif
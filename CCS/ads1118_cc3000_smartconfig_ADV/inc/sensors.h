@@ -40,6 +40,22 @@ typedef enum
     SENSOR_END
 } sensorEnum;
 
+#define SAMPLE_WINDOW 30	// readings taken at 1 Hz between two uploads
+
+// Publish policy of a sensor alias. A reading goes into the window once it
+// differs from the last one published by more than the deadband, the larger
+// of the absolute and the relative band. Readings closer than minInterval to
+// the last one are held back; one goes out at least every heartbeat anyway.
+typedef struct
+{
+    int deadband;					// absolute band, in reading units
+    unsigned char percent;			// relative band, of the last value published
+    unsigned short minInterval;		// s
+    unsigned short heartbeat;		// s
+} publishPolicy;
+
+extern const publishPolicy sensorPolicy[SENSOR_END];
+
 
 int getSensorResult(unsigned char sensorNum);
 void setupSensors(void);
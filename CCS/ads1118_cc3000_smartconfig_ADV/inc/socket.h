@@ -111,6 +111,8 @@ extern "C" {
 	
 #define NO_QUERY_RECIVED        -3
 	
+// Defined in cc3000_common.h, which need not come first
+struct timeval;
 	
 typedef struct _in_addr_t
 {
@@ -133,6 +135,16 @@ typedef struct _sockaddr_in_t
 
 typedef unsigned long socklen_t;
 
+// One buffer of data for sendv()
+typedef struct _iov_t
+{
+    const void *     iov_base;              // start of the data
+    long             iov_len;               // data length in bytes
+} iov;
+
+// Completion callback of the asynchronous calls, given the request handle
+typedef void (*tSocketAsyncCB)(long lHandle, long lResult, void *pCtx);
+
 // The fd_set member is required to be an array of longs.
 typedef long int __fd_mask;
 
@@ -543,6 +555,45 @@ extern int getsockopt(long sd, long level, long optname, void *optval,
 //*****************************************************************************
 extern int recv(long sd, void *buf, long len, long flags);
 
+//*****************************************************************************
+//
+//!  recv_peek
+//!
+//!  @param[in]  sd     socket handle
+//!  @param[out] ptr    receives where the message starts
+//!  @param[in,out] len most bytes to receive, at most what the SPI RX buffer
+//!                     takes in one packet; receives the bytes at *ptr
+//!
+//!  @return         Return the number of bytes received, or -1 if an error
+//!                  occurred, as recv()
+//!
+//!  @brief          Receives a message like recv(), but leaves it in the SPI
+//!                  RX buffer for the caller to parse in place instead of
+//!                  copying it out. When something was received the buffer
+//!                  is lent to the caller and has to be given back with
+//!                  recv_release() before any other driver call is made.
+//!
+//!  @sa recv_release
+//
+//*****************************************************************************
+extern int recv_peek(long sd, unsigned char **ptr, long *len);
+
+//*****************************************************************************
+//
+//!  recv_release
+//!
+//!  @param[in]  sd     socket handle, as given to recv_peek()
+//!
+//!  @return         none
+//!
+//!  @brief          Gives back the message lent by recv_peek(); the pointer
+//!                  it handed out is no longer valid after this
+//!
+//!  @sa recv_peek
+//
+//*****************************************************************************
+extern void recv_release(long sd);
+
 //*****************************************************************************
 //
 //!  recvfrom
@@ -598,6 +649,76 @@ extern int recvfrom(long sd, void *buf, long len, long flags, sockaddr *from,
 
 extern int send(long sd, const void *buf, long len, long flags);
 
+//*****************************************************************************
+//
+//!  sendv
+//!
+//!  @param sd       socket handle
+//!  @param vec      array of buffers to be sent one after the other
+//!  @param count    number of buffers in vec
+//!  @param flags    On this version, this parameter is not supported
+//!
+//!  @return         Return the number of bytes transmitted, or -1 if an
+//!                  error occurred before anything was transmitted
+//!
+//!  @brief          Write data gathered from several buffers to TCP socket.
+//!                  The buffers are packed into as few SEND packets as the 
+//!                  TX buffer allows, so each packet takes one CC3000 buffer
+//!                  and one SPI transaction however the data is split up.
+//!
+//!  @Note           On this version, only blocking mode is supported.
+//!
+//!  @sa             send
+//
+//*****************************************************************************
+
+extern int sendv(long sd, const iov *vec, long count, long flags);
+
+//*****************************************************************************
+//
+//!  sl_send_reserve
+//!
+//!  @param sd       socket handle
+//!  @param ptr      receives where the data is to be written
+//!  @param maxlen   most bytes the caller wants to write
+//!
+//!  @return         Number of bytes that may be written at *ptr, at most
+//!                  maxlen, or a negative value as for send() if no packet
+//!                  can be sent
+//!
+//!  @brief          Reserves the TX buffer for one SEND packet and hands out
+//!                  its data area, behind the HCI headers, so that the data
+//!                  can be formatted in place rather than copied in by
+//!                  send(). A successful reservation takes one CC3000
+//!                  buffer and has to be followed by sl_send_commit().
+//!
+//!  @Note           The TX buffer is shared by every driver call, so no
+//!                  other call may be made until sl_send_commit().
+//!
+//!  @sa             sl_send_commit
+//
+//*****************************************************************************
+
+extern long sl_send_reserve(long sd, unsigned char **ptr, long maxlen);
+
+//*****************************************************************************
+//
+//!  sl_send_commit
+//!
+//!  @param sd       socket handle, as given to sl_send_reserve()
+//!  @param len      bytes written at the reserved pointer, at least 1
+//!
+//!  @return         Return the number of bytes transmitted
+//!
+//!  @brief          Sends the data written into the area reserved by
+//!                  sl_send_reserve() as one SEND packet
+//!
+//!  @sa             sl_send_reserve
+//
+//*****************************************************************************
+
+extern int sl_send_commit(long sd, long len);
+
 //*****************************************************************************
 //
 //!  sendto
@@ -645,6 +766,163 @@ extern int sendto(long sd, const void *buf, long len, long flags,
 //*****************************************************************************
 extern int mdnsAdvertiser(unsigned short mdnsEnabled, char * deviceServiceName, unsigned short deviceServiceNameLength);
 
+//*****************************************************************************
+//
+// Asynchronous variants of the blocking calls above. Each one sends its
+// command and returns a request handle at once; the callback is then called
+// with that handle and the result the blocking call would have returned.
+// Up to SOCKET_ASYNC_REQUESTS can be in flight.
+//
+// The callbacks run from the event handler, that is in the SPI interrupt
+// with interrupts disabled: they should only store the result and flag the
+// main loop, and must not make driver calls. A blocking call of the same kind
+// must not be in flight at the same time, since events that carry no socket
+// go to the oldest request waiting for them.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//!  connect_async
+//!
+//!  @param[in]   sd          socket descriptor (handle)
+//!  @param[in]   addr        specifies the destination addr, as connect()
+//!  @param[in]   addrlen     contains the size of the structure pointed to
+//!                           by addr
+//!  @param[in]   pfCallback  called with the result of connect()
+//!  @param[in]   pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no request slot is
+//!           free
+//!
+//!  @brief  Starts connect() and returns without waiting for the connection
+//!
+//!  @sa connect
+//
+//*****************************************************************************
+extern long connect_async(long sd, const sockaddr *addr, long addrlen,
+            tSocketAsyncCB pfCallback, void *pCtx);
+
+//*****************************************************************************
+//
+//!  recv_async
+//!
+//!  @param[in]  sd          socket handle
+//!  @param[out] buf         where the message is stored; has to stay valid
+//!                          until the callback
+//!  @param[in]  len         size of buf, at most what the SPI RX buffer takes
+//!                          in one packet
+//!  @param[in]  flags       as recv()
+//!  @param[in]  pfCallback  called with the number of bytes received, or a
+//!                          negative error, as recv() returns
+//!  @param[in]  pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -1 on a bad length, -2 if
+//!           no request slot is free
+//!
+//!  @brief  Starts recv() and returns without waiting for the message
+//!
+//!  @sa recv
+//
+//*****************************************************************************
+extern long recv_async(long sd, void *buf, long len, long flags,
+            tSocketAsyncCB pfCallback, void *pCtx);
+
+//*****************************************************************************
+//
+//!  send_async
+//!
+//!  @param[in]  sd          socket handle
+//!  @param[in]  buf         message to send, copied before the call returns
+//!  @param[in]  len         message size in bytes
+//!  @param[in]  pfCallback  called with the bytes the CC3000 sent, or a
+//!                          negative error
+//!  @param[in]  pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no CC3000 buffer or
+//!           no request slot is free, other negative values as send()
+//!
+//!  @brief  Sends like send(), but instead of waiting for a free CC3000
+//!          buffer returns -2 for the caller to try again later
+//!
+//!  @sa send
+//
+//*****************************************************************************
+extern long send_async(long sd, const void *buf, long len,
+            tSocketAsyncCB pfCallback, void *pCtx);
+
+//*****************************************************************************
+//
+//!  select_async
+//!
+//!  @param[in]   nfds        the highest-numbered file descriptor in any of
+//!                           the three sets, plus 1
+//!  @param[out]  readsds     socket descriptors list for read monitoring
+//!  @param[out]  writesds    socket descriptors list for write monitoring
+//!  @param[out]  exceptsds   socket descriptors list for exception monitoring
+//!  @param[in]   timeout     as select()
+//!  @param[in]   pfCallback  called with the number of ready sockets, or the
+//!                           negative error
+//!  @param[in]   pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no request slot is
+//!           free
+//!
+//!  @brief  Starts select() and returns without waiting for the sockets.
+//!          The lists are updated, as select() does, just before the
+//!          callback and have to stay valid until then.
+//!
+//!  @sa select
+//
+//*****************************************************************************
+extern long select_async(long nfds, fd_set *readsds, fd_set *writesds, fd_set *exceptsds, 
+            struct timeval *timeout, tSocketAsyncCB pfCallback, void *pCtx);
+
+//*****************************************************************************
+//
+//!  gethostbyname_async
+//!
+//!  @param[in]   hostname     host name
+//!  @param[in]   usNameLen    name length
+//!  @param[out]  out_ip_addr  filled in with the host IP address just before
+//!                            the callback; has to stay valid until then
+//!  @param[in]   pfCallback   called with what gethostbyname() returns
+//!  @param[in]   pCtx         passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -1 if the name is too
+//!           long, -2 if no request slot is free
+//!
+//!  @brief  Starts gethostbyname() and returns without waiting for the DNS
+//!          answer
+//!
+//!  @sa gethostbyname
+//
+//*****************************************************************************
+#ifndef CC3000_TINY_DRIVER
+extern long gethostbyname_async(char * hostname, unsigned short usNameLen,
+            unsigned long* out_ip_addr, tSocketAsyncCB pfCallback,
+            void *pCtx);
+#endif
+
+//*****************************************************************************
+//
+//!  closesocket_async
+//!
+//!  @param[in]  sd          socket handle
+//!  @param[in]  pfCallback  called with what closesocket() returns
+//!  @param[in]  pCtx        passed to pfCallback
+//!
+//!  @return  request handle (positive) on success, -2 if no request slot is
+//!           free
+//!
+//!  @brief  Starts closesocket() and returns without waiting for the socket
+//!          to close. The socket is marked inactive when it completes.
+//!
+//!  @sa closesocket
+//
+//*****************************************************************************
+extern long closesocket_async(long sd, tSocketAsyncCB pfCallback, void *pCtx);
+
 //*****************************************************************************
 //
 // Close the Doxygen group.
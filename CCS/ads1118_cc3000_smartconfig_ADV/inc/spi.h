@@ -78,7 +78,10 @@ extern unsigned char wlan_tx_buffer[];
 extern void SpiOpen(gcSpiHandleRx pfRxHandler);
 extern void SpiClose(void);
 extern long SpiWrite(unsigned char *pUserBuffer, unsigned short usLength);
+extern void SpiPauseSpi(void);
 extern void SpiResumeSpi(void);
+extern void SpiWaitTransfer(void);
+extern void SpiReleaseRxBuffer(void);
 extern void SpiConfigureHwMapping(	unsigned long ulPioPortAddress,
 									unsigned long ulPort, 
 									unsigned long ulSpiCs, 
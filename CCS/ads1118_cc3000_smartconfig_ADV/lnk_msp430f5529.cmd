@@ -61,8 +61,11 @@ MEMORY
     INFOB                   : origin = 0x1900, length = 0x0080
     INFOC                   : origin = 0x1880, length = 0x0080
     INFOD                   : origin = 0x1800, length = 0x0080
-    FLASH                   : origin = 0x4400, length = 0xBB80
-    FLASH2                  : origin = 0x10000,length = 0x14400
+    CONFIG                  : origin = 0x4400, length = 0x0400  /* config_store.c copies A and B, nothing linked here */
+    FLASH                   : origin = 0x4800, length = 0xB780
+    FLASH2                  : origin = 0x10000,length = 0xC000
+    EXOMETA                 : origin = 0x1C000,length = 0x0400  /* exosite_meta.c log, nothing linked here */
+    SAMPLELOG               : origin = 0x1C400,length = 0x8000  /* sample_log.c, nothing linked here */
     INT00                   : origin = 0xFF80, length = 0x0002
     INT01                   : origin = 0xFF82, length = 0x0002
     INT02                   : origin = 0xFF84, length = 0x0002
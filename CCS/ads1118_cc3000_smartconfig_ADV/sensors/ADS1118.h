@@ -57,6 +57,8 @@ int ADC_display(); //CONV_
 void init_spi_ads1118(void);
 void lcd_system_Initial();
 void ads1118Main();
+unsigned char sampleSensors(void);
+void ads1118Tick(void);
 void ads1118Extra();
 void delay(void);
 void time_display();
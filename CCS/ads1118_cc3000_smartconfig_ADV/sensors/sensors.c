@@ -40,6 +40,7 @@
 #include "LCD_driver.h"
 #include "exosite.h"
 #include "board.h"
+#include "spi.h"
 
 const char sensorNames[10][11] = {
 									"tmpc",
@@ -54,18 +55,27 @@ const char sensorNames[10][11] = {
 									"na9"
                                 };
 
+// Publish policy of each alias of sensorNames, tmpc in tenths of a degree
+const publishPolicy sensorPolicy[SENSOR_END] = {
+									{5, 0, 5, 300},		// tmpc: half a degree, 5 min heartbeat
+									{0, 0, 0, 600}		// na1
+                                };
+
 int tempValue; //CONV_
 int Act_temp;	// Actual temperature
 int Act_temp_D;	// Actual temperature
 int radioStatus = 0;
 int exoinit = 0;
 extern int sensorValue[10];
+extern unsigned char recordSample(void);
 extern int exoTempThr; //temperature update from Exosite
 extern unsigned long exoTimer; //temperature update from Exosite
 unsigned long exoTimerHH = 0;
 unsigned long exoTimerMM = 0;
 unsigned long exoTimerSS = 0;
 unsigned long time = 0;	// current time, a Continuous number seconds
+volatile unsigned long uptime = 0;	// seconds since boot, never reset
+unsigned long sampleSecond;	// uptime of the last reading
 unsigned int set_time;	// temporary for setting time
 unsigned int Thr_temp;	// Threshold temperature
 unsigned int set_temp;	// temporary for setting Threshold temperature
@@ -150,18 +160,13 @@ void ads1118Main()
 	//Read temperature and update display
 	if(radioStatus == 0)
 	  { 										//Check if already init
+		  Exosite_Disconnect();					// kept-alive socket does not survive the radio reset
 		  WLAN_EN_OUT &= ~WLAN_EN_PIN;          // RF_EN_PIN low to put CC3000 in shut-down mode
 		  init_spi_ads1118(); 					//config SPI for ADS1118BP
-		  unsigned char sensorCount = 0;
-		  char strRead[6];
-		  for (sensorCount = 0; sensorCount < NA1; sensorCount++) 			//SENSOR_END
-				{
-				  sensorValue[sensorCount] = getSensorResult(sensorCount);	//get the sensor reading
-				  itoa(sensorValue[sensorCount], strRead, 10);
-					  sendString("\t");
-					  sendString(strRead);
-				}
-		  sendString("\r\n");
+		  while (sampleSensors())				// one reading a second until the window is full
+		  {
+			  while (sampleSecond == uptime);		// wait for the next second
+		  }
 
 		  if (flag & BITD)
 		  {
@@ -220,6 +225,66 @@ int ADC_display()
 		return Act_temp;
 }
 
+//*****************************************************************************
+//
+//!  sampleSensors
+//!
+//!  \param  None
+//!
+//!  \return nonzero while the sample window takes more readings
+//!
+//!  \brief  Takes one reading of the sensors and adds it to the sample
+//!          window. The SPI has to be configured for the ADS1118.
+//
+//*****************************************************************************
+unsigned char sampleSensors(void)
+{
+	unsigned char sensorCount;
+	char strRead[6];
+
+	sampleSecond = uptime;
+	for (sensorCount = 0; sensorCount < NA1; sensorCount++) 			//SENSOR_END
+	{
+		sensorValue[sensorCount] = getSensorResult(sensorCount);	//get the sensor reading
+		itoa(sensorValue[sensorCount], strRead, 10);
+		sendString("\t");
+		sendString(strRead);
+	}
+	sendString("\r\n");
+	return recordSample();
+}
+
+//*****************************************************************************
+//
+//!  ads1118Tick
+//!
+//!  \param  None
+//!
+//!  \return None
+//!
+//!  \brief  Takes a reading once a second while the CC3000 is up, e.g.
+//!          while an upload or a long-poll is in flight. The ADS1118 shares the SPI with
+//!          the CC3000: the CC3000 interrupt is held off and the SPI is set
+//!          up for the ADS1118 for the reading, then handed back. Must not
+//!          be called from inside a CC3000 driver call.
+//
+//*****************************************************************************
+void ads1118Tick(void)
+{
+	if (sampleSecond == uptime)
+		return;
+	SpiPauseSpi();
+	SpiWaitTransfer();						// a DMA read may still be on the SPI
+	init_spi_ads1118();
+	sampleSensors();
+	if (!(flag & BITB))
+	{
+		ads1118Extra();						// clock display and the controls applied since
+	}
+	init_spi();
+	SpiResumeSpi();							// an event held off meanwhile is taken now
+}
+
 void init_spi_ads1118(void)
 {
     UCB0CTL1 |= UCSWRST;
@@ -341,6 +406,7 @@ __interrupt void TIMER2_A1_ISR(void)
     		if (!(flag & BIT6))
     			flag |= BIT3;
     		time++;
+    		uptime++;
              break;
     default: break;
   }
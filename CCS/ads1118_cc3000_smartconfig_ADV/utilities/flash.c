@@ -0,0 +1,139 @@
+/*****************************************************************************
+*
+*  flash.c - Append-only writer for the MSP430 main flash
+*  Copyright (C) 2014 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Texas Instruments Incorporated nor the names of
+*    its contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include <msp430.h>
+#include "flash.h"
+
+// Addresses are 20 bits wide so the flash above 64K (FLASH2) can be used
+// whatever the data model; it is accessed with the __data20 intrinsics.
+// Flash bits can only be programmed from 1 to 0 - a location has to be
+// erased with its whole segment before it can take arbitrary data again.
+
+//*****************************************************************************
+//
+//!  flashEraseSegment
+//!
+//!  \param  address - any address in the segment to erase
+//!
+//!  \return none
+//!
+//!  \brief  Erases a 512 byte main flash segment to all 0xFF
+//
+//*****************************************************************************
+void
+flashEraseSegment(unsigned long address)
+{
+  unsigned short state = __get_interrupt_state();
+
+  __disable_interrupt();
+  while (FCTL3 & BUSY);
+  FCTL3 = FWKEY;                            // Clear Lock bit
+  FCTL1 = FWKEY + ERASE;                    // Set Erase bit
+  __data20_write_char(address, 0);          // Dummy write to erase Flash seg
+  while (FCTL3 & BUSY);
+  FCTL1 = FWKEY;                            // Clear Erase bit
+  FCTL3 = FWKEY + LOCK;                     // Set LOCK bit
+  __set_interrupt_state(state);
+}
+
+//*****************************************************************************
+//
+//!  flashWrite
+//!
+//!  \param  address - flash address to write to; pdata - data to write;
+//!          len - number of bytes to write
+//!
+//!  \return none
+//!
+//!  \brief  Programs bytes into erased flash. Bytes already written can be
+//!          written again to clear more of their bits.
+//
+//*****************************************************************************
+void
+flashWrite(unsigned long address, const void * pdata, unsigned char len)
+{
+  const unsigned char * p = (const unsigned char *)pdata;
+  unsigned short state = __get_interrupt_state();
+
+  __disable_interrupt();
+  while (FCTL3 & BUSY);
+  FCTL3 = FWKEY;                            // Clear Lock bit
+  FCTL1 = FWKEY + WRT;                      // Set WRT bit for write operation
+  while (0 < len--)
+  {
+    __data20_write_char(address++, *p++);
+    while (FCTL3 & BUSY);
+  }
+  FCTL1 = FWKEY;                            // Clear WRT bit
+  FCTL3 = FWKEY + LOCK;                     // Set LOCK bit
+  __set_interrupt_state(state);
+}
+
+//*****************************************************************************
+//
+//!  flashRead
+//!
+//!  \param  address - flash address to read from; pbuf - buffer to read
+//!          into; len - number of bytes to read
+//!
+//!  \return none
+//!
+//!  \brief  Reads bytes from flash
+//
+//*****************************************************************************
+void
+flashRead(unsigned long address, void * pbuf, unsigned char len)
+{
+  unsigned char * p = (unsigned char *)pbuf;
+
+  while (0 < len--)
+    *p++ = __data20_read_char(address++);
+}
+
+//*****************************************************************************
+//
+//!  flashReadByte
+//!
+//!  \param  address - flash address to read from
+//!
+//!  \return the byte at address
+//!
+//!  \brief  Reads a single byte from flash
+//
+//*****************************************************************************
+unsigned char
+flashReadByte(unsigned long address)
+{
+  return __data20_read_char(address);
+}
@@ -26,107 +26,332 @@
 //*****************************************************************************
 
 #include <SPI.h>
+#include <ctype.h>
 #include "Exosite.h"
 #include "Energia.h"
 
 #define serverName        "m2.exosite.com"
 #define ACTIVATOR_VERSION  F("2.1")
+#define RX_POLL_MS         10  // sleep between polls for the response
 
 /*==============================================================================
-* Exosite
+* RequestWriter
 *
-* constructor for Exosite class
+* Print that collects the request in a buffer and hands it to the Client in
+* as few writes as it takes to fill the buffer, so the request doesn't go
+* out as one TCP segment per print.
 *=============================================================================*/
-Exosite::Exosite(String _cik, Client *_client)
+class RequestWriter : public Print
+{
+  private:
+    Client* client;
+    char* buf;
+    size_t size;
+    size_t len;
+
+  public:
+    RequestWriter(Client* _client, char* _buf, size_t _size)
+      : client(_client), buf(_buf), size(_size), len(0) {}
+
+    size_t write(uint8_t b){
+      if (len == size)
+        flush();
+      buf[len++] = b;
+      return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t n){
+      size_t chunk;
+      size_t left = n;
+
+      while (left) {
+        if (len == size)
+          flush();
+        chunk = size - len < left ? size - len : left;
+        memcpy(buf + len, data, chunk);
+        len += chunk;
+        data += chunk;
+        left -= chunk;
+      }
+      return n;
+    }
+
+    void flush(){
+      if (len)
+        client->write((const uint8_t*)buf, len);
+      len = 0;
+    }
+};
+
+/*==============================================================================
+* ExositeBase
+*
+* constructor for Exosite classes, on the buffers of BasicExosite
+*=============================================================================*/
+ExositeBase::ExositeBase(String _cik, Client *_client, char* _rxdata, size_t _rxSize, char* _txdata, size_t _txSize)
 {
   cik = _cik;
   client = _client;
+  rxdata = _rxdata;
+  rxSize = _rxSize;
+  txdata = _txdata;
+  txSize = _txSize;
+  timeout = 3000; // 3 seconds
 }
 
 /*==============================================================================
-* writeRead
+* setTimeout
 *
-* One step read and write to Exosite using char arrays.
-*=============================================================================*/
-boolean Exosite::writeRead(char* writeString, char* readString, char** returnString){
-  ret = false;
-  stringPos = 0;
-  DataRx= false;
-  RxLoop = true;
-  timeout_time = 0;
-  time_now = 0;
-  timeout = 3000; // 3 seconds
-  varPtr = aliasList;
+* Sets how long a request waits for the whole response, in ms.
+*=============================================================================*/
+void ExositeBase::setTimeout(unsigned long ms){
+  timeout = ms;
+}
 
-  if (client->connect(serverName,80)) {
-    client->flush();
+/*==============================================================================
+* formatValue
+*
+* Formats a fixed point value into buf, which takes VALUE_CHARS. Returns the
+* length.
+*=============================================================================*/
+#define VALUE_CHARS 14  // sign, 10 digits or up to 9 decimals, point, null
+static int formatValue(char* buf, long value, unsigned char decimals)
+{
+  char digits[11];
+  unsigned long magnitude = value < 0 ? 0 - (unsigned long)value : value;
+  int count = 0;
+  int len = 0;
+
+  if (decimals > 9)
+    decimals = 9;
+  do {
+    digits[count++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude || count <= decimals);
 
-    char buffer [200];
-
-    // Send request using Exosite basic HTTP API
-    client->print(F("POST /onep:v1/stack/alias?"));
-    client->print(readString);
-    client->println(F(" HTTP/1.1"));
-    client->println(F("Host: m2.exosite.com"));
-    client->print(F("User-Agent: Exosite-Activator/"));
-    client->print(ACTIVATOR_VERSION);
-    client->print(F(" Energia/"));
-    client->println(ENERGIA);
-    client->print(F("X-Exosite-CIK: "));
-    client->println(cik);
-    client->println(F("Accept: application/x-www-form-urlencoded; charset=utf-8"));
-    client->println(F("Content-Type: application/x-www-form-urlencoded; charset=utf-8"));
-    client->print(F("Content-Length: "));
-	client->println(strlen(writeString)); //calculate length 
-		//ALT //client->println(itoa(strlen(writeString),buffer,10)); //calculate length 
-    client->println();
-    client->println(writeString);
-
-    // Read from the nic or the IC buffer overflows with no warning and goes out to lunch
-    timeout_time = millis()+ timeout;
-    
-    while ((timeout_time > time_now) && RxLoop) {
-      if (client->available()) {
-        if (!DataRx)
-          DataRx= true;
-        
-        c = client->read();
-        rxdata[stringPos] = c;
-        
-        stringPos += 1;
+  if (value < 0)
+    buf[len++] = '-';
+  while (count) {
+    if (count == decimals)
+      buf[len++] = '.';
+    buf[len++] = digits[--count];
+  }
+  buf[len] = 0;
+
+  return len;
+}
+
+/*==============================================================================
+* renderValues
+*
+* Formats the alias=value pairs of the request body into txdata. Returns the
+* length, or -1 if they don't fit.
+*=============================================================================*/
+int ExositeBase::renderValues(const ExositeValue* values, int count){
+  char buffer [VALUE_CHARS];
+  size_t len = 0;
+  size_t alias, value;
+
+  for (int i = 0; i < count; i++) {
+    alias = strlen(values[i].alias);
+    value = formatValue(buffer, values[i].value, values[i].decimals);
+    if (len + (i ? 1 : 0) + alias + 1 + value >= txSize)
+      return -1;
+    if (i)
+      txdata[len++] = '&';
+    memcpy(txdata + len, values[i].alias, alias);
+    len += alias;
+    txdata[len++] = '=';
+    memcpy(txdata + len, buffer, value);
+    len += value;
+  }
+  txdata[len] = 0;
+
+  return len;
+}
+
+/*==============================================================================
+* contentLength
+*
+* Value of a Content-Length header line, -1 if line is another header. Header
+* names are matched without regard to case.
+*=============================================================================*/
+static long contentLength(const char* line)
+{
+  static const char name[] = "content-length:";
+  size_t i;
+
+  for (i = 0; name[i] && tolower(line[i]) == name[i]; i++)
+    ;
+  if (!name[i])
+    return atol(line + i);
+
+  return -1;
+}
+
+/*==============================================================================
+* receive
+*
+* Reads the response until Content-Length bytes of body are in, the server
+* closes the connection or the deadline passes. Sleeps between polls. Header
+* lines are parsed as they come and dropped, so rxdata only keeps the status
+* line, an empty line and the body. length receives the bytes kept; returns
+* false on timeout or if the response doesn't fit.
+*=============================================================================*/
+boolean ExositeBase::receive(size_t* length){
+  unsigned long start = millis();
+  size_t stringPos = 0;
+  size_t lineStart = 0;
+  size_t lineLength = 0;
+  size_t bodyStart = 0;
+  size_t bodyReceived = 0;
+  long bodyLength = -1;
+  long value;
+  boolean truncated = false;
+  boolean lineCut = false;
+  int avail;
+  int got;
+  int c;
+
+  rxdata[0] = 0;
+  while (1) {
+    if (millis() - start >= timeout) {
+      Serial.println(F("Exosite response timed out."));
+      return false;
+    }
+    avail = client->available();
+    if (avail > 0 && !bodyStart) {
+      // headers: a line at a time after the status line, kept only until
+      // it is parsed; a line longer than the room left is cut short
+      c = client->read();
+      if (c < 0)
+        continue;
+      lineLength++;
+      if (stringPos < rxSize - 1)
+        rxdata[stringPos++] = (char)c;
+      else
+        lineCut = true;
+      rxdata[stringPos] = 0;
+      if ('\n' != c)
+        continue;
+      if (!lineStart) {
+        lineStart = stringPos;
+        truncated = lineCut;
+      } else if (lineLength <= 2) {
+        // the empty line: the body follows
+        bodyStart = stringPos;
+        truncated = truncated || lineCut;
+        if (!strncmp(rxdata + 8, " 204", 4) || !strncmp(rxdata + 8, " 304", 4))
+          bodyLength = 0;
       } else {
+        if ((value = contentLength(rxdata + lineStart)) >= 0) {
+          bodyLength = value;
+          // the digits may have been cut off
+          truncated = truncated || lineCut;
+        }
+        stringPos = lineStart;
         rxdata[stringPos] = 0;
+      }
+      lineLength = 0;
+      lineCut = false;
+    } else if (avail > 0) {
+      // don't read past the body
+      if (bodyLength >= 0 && (size_t)avail > (size_t)bodyLength - bodyReceived)
+        avail = (int)((size_t)bodyLength - bodyReceived);
+      // keep the last byte for the terminator, drop what doesn't fit
+      if (stringPos < rxSize - 1) {
+        if ((size_t)avail > rxSize - 1 - stringPos)
+          avail = rxSize - 1 - stringPos;
+        got = client->read((uint8_t*)rxdata + stringPos, avail);
+        if (got <= 0)
+          got = 0;
+        stringPos += got;
+        rxdata[stringPos] = 0;
+      } else {
+        client->read();
+        got = 1;
+        truncated = true;
+      }
+      bodyReceived += got;
+    } else if (!client->connected()) {
+      break;
+    } else {
+      sleep(RX_POLL_MS);
+    }
+    if (bodyStart && bodyLength >= 0 && bodyReceived >= (size_t)bodyLength)
+      break;
+  }
 
-        if (DataRx) {
-          DataRx = false;
-          RxLoop = false;
-          Serial.println("HTTP Response:");
-          Serial.println(rxdata);
-		  	if (strstr(rxdata, "HTTP/1.1 200 OK"))
-		  	{
-				ret = true;
-				varPtr = strstr(rxdata, "\r\n\r\n") + 4;
-
-				*returnString = (char*) strncpy(*returnString, *returnString, (rxdata + stringPos + 1) - varPtr);
-					//ORIG //*returnString = (char*) realloc(*returnString, (rxdata + stringPos + 1) - varPtr);
-
-				if(*returnString == 0)
-				  break;
-
-				strncpy(*returnString, varPtr, (rxdata + stringPos + 1) - varPtr);
-		  	}
-			else if(strstr(rxdata, "HTTP/1.1 204 No Content"))
-			{
-				ret = true;
-			}
-			else
-			{
-				varPtr = strstr(rxdata, "\n");
-				*varPtr = '\0';
-			}
-        }
+  *length = stringPos;
+  if (truncated) {
+    Serial.println(F("Response doesn't fit the receive buffer."));
+    return false;
+  }
+
+  return true;
+}
+
+/*==============================================================================
+* exchange
+*
+* Sends one request, writing either the alias/value pairs or writeString and
+* reading the aliases of readString. On success varPtr points to the response
+* body in rxdata, empty if there was none.
+*=============================================================================*/
+boolean ExositeBase::exchange(const ExositeValue* values, int count, const char* writeString, const char* readString){
+  boolean ret = false;
+  size_t stringPos;
+
+  if (values) {
+    if (renderValues(values, count) < 0) {
+      Serial.println(F("Values don't fit the transmit buffer."));
+      return false;
+    }
+    writeString = txdata;
+  }
+
+  if (client->connect(serverName,80)) {
+    client->flush();
+
+    // Send request using Exosite basic HTTP API, staged in rxdata until
+    // the response comes
+    RequestWriter request(client, rxdata, rxSize);
+    request.print(F("POST /onep:v1/stack/alias?"));
+    request.print(readString);
+    request.println(F(" HTTP/1.1"));
+    request.println(F("Host: m2.exosite.com"));
+    request.print(F("User-Agent: Exosite-Activator/"));
+    request.print(ACTIVATOR_VERSION);
+    request.print(F(" Energia/"));
+    request.println(ENERGIA);
+    request.print(F("X-Exosite-CIK: "));
+    request.println(cik);
+    request.println(F("Accept: application/x-www-form-urlencoded; charset=utf-8"));
+    request.println(F("Content-Type: application/x-www-form-urlencoded; charset=utf-8"));
+    request.print(F("Content-Length: "));
+    request.println(strlen(writeString)); //calculate length
+    request.println();
+    request.println(writeString);
+    request.flush();
+
+    if (receive(&stringPos))
+    {
+      Serial.println("HTTP Response:");
+      Serial.println(rxdata);
+      if (strstr(rxdata, "HTTP/1.1 200 OK") && (varPtr = strstr(rxdata, "\r\n\r\n")))
+      {
+        ret = true;
+        varPtr += 4;
+      }
+      else if(strstr(rxdata, "HTTP/1.1 204 No Content"))
+      {
+        ret = true;
+        varPtr = rxdata + stringPos;
+      }
+      else if ((varPtr = strstr(rxdata, "\n")))
+      {
+        *varPtr = '\0';
       }
-      time_now = millis();
     }
   }
   else
@@ -142,34 +367,67 @@ boolean Exosite::writeRead(char* writeString, char* readString, char** returnStr
 /*==============================================================================
 * writeRead
 *
-* One step read and write to Exosite using Arduino String objects.
+* One step read and write to Exosite using char arrays. returnString must
+* hold the whole response body.
 *=============================================================================*/
-boolean Exosite::writeRead(String writeString, String readString, String &returnString){
-  char *writeCharString, *readCharString, *returnCharString;
-  writeCharString = (char*)malloc(sizeof(char) * writeString.length()+1);
-  readCharString = (char*)malloc(sizeof(char) * readString.length()+1);
-  returnCharString = (char*)malloc(sizeof(char) * 32);
+boolean ExositeBase::writeRead(char* writeString, char* readString, char** returnString){
+  if (!exchange(0, 0, writeString, readString))
+    return false;
 
-  if(writeCharString == 0 || readCharString == 0 || returnCharString == 0){
-    Serial.println(F("Not Enough Ram! Failing!"));
-    while(1);
-  }
+  strcpy(*returnString, varPtr);
 
-  writeString.toCharArray(writeCharString, writeString.length()+1);
-  readString.toCharArray(readCharString, readString.length()+1);
+  return true;
+}
 
-  if(this->writeRead(writeCharString, readCharString, &returnCharString)){
-    returnString = returnCharString;
-    ret = true;
+/*==============================================================================
+* writeRead
+*
+* One step read and write to Exosite using Arduino String objects.
+*=============================================================================*/
+boolean ExositeBase::writeRead(const String& writeString, const String& readString, String &returnString){
+  if(exchange(0, 0, writeString.c_str(), readString.c_str())){
+    returnString = varPtr;
+    return true;
   }else{
     Serial.println(F("Error Communicating with Exosite"));
-    ret = false;
+    return false;
   }
-  free(writeCharString);
-  free(readCharString);
-  free(returnCharString);
+}
 
-  return ret;
+/*==============================================================================
+* writeRead
+*
+* One step read and write to Exosite of alias/value pairs, formatted straight
+* into the request. returnString is set to the response body, which stays
+* valid until the next request.
+*=============================================================================*/
+boolean ExositeBase::writeRead(const ExositeValue* values, int count, const char* readString, const char** returnString){
+  if (!exchange(values, count, 0, readString))
+    return false;
+
+  *returnString = varPtr;
+
+  return true;
+}
+
+/*==============================================================================
+* write
+*
+* Writes alias/value pairs to Exosite.
+*=============================================================================*/
+boolean ExositeBase::write(const ExositeValue* values, int count){
+  return exchange(values, count, 0, "");
+}
+
+/*==============================================================================
+* write
+*
+* Writes one value to an alias, fixed point with decimals.
+*=============================================================================*/
+boolean ExositeBase::write(const char* alias, long value, unsigned char decimals){
+  ExositeValue pair = {alias, value, decimals};
+
+  return exchange(&pair, 1, 0, "");
 }
 
 /*==============================================================================
@@ -181,13 +439,8 @@ boolean Exosite::writeRead(String writeString, String readString, String &return
 *
 * send data to cloud
 *=============================================================================*/
-int Exosite::sendToCloud(String res, int value){
-  String readString = "";
-  String returnString = "";
-  String writeString;
-  writeString = res + "=" + value;
-
-  if(this->writeRead(writeString, readString, returnString)){
+int ExositeBase::sendToCloud(const String& res, int value){
+  if(this->write(res.c_str(), value)){
     return 1;
   }else{
     Serial.println(F("Error Communicating with Exosite"));
@@ -201,10 +454,9 @@ int Exosite::sendToCloud(String res, int value){
 *
 * read data from cloud
 *=============================================================================*/
-int Exosite::readFromCloud(String readString ,String* returnString){
-  String writeString = "";
-
-  if(this->writeRead(writeString, readString, *returnString)){
+int ExositeBase::readFromCloud(const String& readString ,String* returnString){
+  if(exchange(0, 0, "", readString.c_str())){
+    *returnString = varPtr;
     return 1;
   }else{
     Serial.println(F("Error Communicating with Exosite"));
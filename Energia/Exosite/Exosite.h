@@ -31,37 +31,71 @@
 #include <SPI.h>
 #include <Client.h>
 
-class Exosite
+// An alias and the value to write to it. With decimals set, value is fixed
+// point: {"temp", 2315, 2} writes temp=23.15.
+struct ExositeValue
+{
+  const char* alias;
+  long value;
+  unsigned char decimals;
+};
+
+// Request code shared by all buffer sizes; sketches use BasicExosite or
+// Exosite, which own the buffers.
+class ExositeBase
 {
   private:
     class Client* client;
     String cik;
-    char rxdata[200];
-    char aliasList[50];
+    char* rxdata;
+    size_t rxSize;
+    char* txdata;
+    size_t txSize;
     char* varPtr;
-    char* varPtr2;
-    boolean ret;
-    int stringPos;
-    boolean DataRx;
-    boolean RxLoop;
-    char c;
-    unsigned long timeout_time;
-    unsigned long time_now;
     unsigned long timeout;
 
+    int renderValues(const ExositeValue* values, int count);
+    boolean receive(size_t* length);
+    boolean exchange(const ExositeValue* values, int count, const char* writeString, const char* readString);
 
-  public:
+  protected:
     // Constructor
-    Exosite(String _cik, Client *_client);
+    ExositeBase(String _cik, Client *_client, char* _rxdata, size_t _rxSize, char* _txdata, size_t _txSize);
 
+  public:
     // Current Methods
     boolean writeRead(char* writeString, char* readString, char** returnString);
-    boolean writeRead(String writeString, String readString, String &returnString);
+    boolean writeRead(const String& writeString, const String& readString, String &returnString);
+    boolean writeRead(const ExositeValue* values, int count, const char* readString, const char** returnString);
+    boolean write(const ExositeValue* values, int count);
+    boolean write(const char* alias, long value, unsigned char decimals = 0);
+    void setTimeout(unsigned long ms);
 
     // Depreciated Methods
-    int sendToCloud(String res, int value);
-    int readFromCloud(String res ,String* pResult);
+    int sendToCloud(const String& res, int value);
+    int readFromCloud(const String& res ,String* pResult);
 
 };
 
+// Exosite client with RxBytes for the response and TxBytes for the alias/value
+// pairs written. Response headers are dropped as they are parsed, so RxBytes
+// only has to hold the status line (17 bytes), a Content-Length line (about
+// 22) and the body, plus 1: at least 40. Size them to the aliases of the
+// sketch: BasicExosite<80, 32> fits a G2 reading up to 60 bytes of values,
+// Exosite is the F5529 default.
+template<size_t RxBytes, size_t TxBytes>
+class BasicExosite : public ExositeBase
+{
+  private:
+    char rxdata[RxBytes];
+    char txdata[TxBytes];
+
+  public:
+    // Constructor
+    BasicExosite(String _cik, Client *_client)
+      : ExositeBase(_cik, _client, rxdata, RxBytes, txdata, TxBytes) {}
+};
+
+typedef BasicExosite<200, 100> Exosite;
+
 #endif